@@ -0,0 +1,150 @@
+/* animate.c
+ * Growth animation from recorded segments
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <string.h>
+#include "animate.h"
+#include "input.h"
+#include "simplegfx.h"
+#include "trace.h"
+#include "tools.h"
+
+/**
+ * Sorts the segments by the depth of the branch they are on, so the
+ * trunk grows first and the finest branches last. The depth is the
+ * number of open brackets in front of the F that drew a segment.
+ */
+static void sortByDepth(Animation *anim, char *lsys) {
+	Geometry *geo = anim->geo;
+	int *depths;
+	int *starts;
+	int depth = 0;
+	int maxDepth = 0;
+	int i;
+	int n;
+	char *p = lsys;
+
+	depths = newn(int, geo->count);
+	for (i = 0; i < geo->count; i++) {
+		/* segments are recorded in the order of their symbols */
+		for (; p < lsys + geo->segs[i].symbol; p++) {
+			if (*p == '[') {
+				depth++;
+			} else if (*p == ']' && depth > 0) {
+				/* like the turtle, ignore unmatched brackets */
+				depth--;
+			}
+		}
+		depths[i] = depth;
+		if (depth > maxDepth) {
+			maxDepth = depth;
+		}
+	}
+
+	/* counting sort, which keeps the drawing order within a depth */
+	n = maxDepth + 2;
+	starts = newn(int, n);
+	memset(starts, 0, n * sizeof(int));
+	for (i = 0; i < geo->count; i++) {
+		starts[depths[i] + 1]++;
+	}
+	for (i = 1; i < n; i++) {
+		starts[i] += starts[i - 1];
+	}
+	for (i = 0; i < geo->count; i++) {
+		anim->order[starts[depths[i]]++] = i;
+	}
+	memFree(starts);
+	memFree(depths);
+}
+
+/**
+ * Prepares the animation of geo, which was recorded from lsys, in the
+ * given order (ANIM_DRAWING or ANIM_DEPTH). The screen is cleared; the
+ * first segments appear with the first call to animFrame().
+ */
+void animStart(Animation *anim, Geometry *geo, char *lsys, View *view,
+		int order) {
+	int i;
+	int n = geo->count > 0 ? geo->count : 1;
+
+	anim->geo = geo;
+	anim->view = *view;
+	anim->shown = 0;
+	anim->order = newn(int, n);
+	if (order == ANIM_DEPTH) {
+		sortByDepth(anim, lsys);
+	} else {
+		for (i = 0; i < geo->count; i++) {
+			anim->order[i] = i;
+		}
+	}
+	sgClearScreen();
+	anim->start = SDL_GetTicks();
+}
+
+/**
+ * Draws the segments that are due at the current time on top of the
+ * previous frame. Returns true when the plant is complete.
+ */
+bool animFrame(Animation *anim) {
+	return animFrameAt(anim, SDL_GetTicks() - anim->start);
+}
+
+/**
+ * Draws the segments that are due the given number of milliseconds after
+ * the start, independent of the actual time, e.g. for recording a video
+ */
+bool animFrameAt(Animation *anim, Uint32 elapsed) {
+	Uint32 white = sgCreateColor(255, 255, 255);
+	double span = traceBegin();
+	int target = anim->geo->count;
+
+	if (elapsed < ANIM_DURATION) {
+		target = (int)((double)anim->geo->count * elapsed / ANIM_DURATION);
+	}
+	for (; anim->shown < target; anim->shown++) {
+		renderHighlight(&anim->geo->segs[anim->order[anim->shown]],
+			&anim->view, white);
+	}
+	traceEnd("animation frame", span);
+	return anim->shown == anim->geo->count;
+}
+
+/**
+ * Waits until the next frame is due, or returns early if the user
+ * wants to do something else
+ */
+void animWait(Animation *anim) {
+	Uint32 frame = 1000 / ANIM_FPS;
+	Uint32 next = ((SDL_GetTicks() - anim->start) / frame + 1) * frame;
+
+	while (SDL_GetTicks() - anim->start < next && !inputPending()) {
+		SDL_Delay(1);
+	}
+}
+
+/**
+ * Frees the animation, but not the geometry
+ */
+void animEnd(Animation *anim) {
+	memFree(anim->order);
+	anim->order = NULL;
+}
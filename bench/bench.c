@@ -0,0 +1,318 @@
+/* bench.c
+ * Headless benchmark over the patterns listed in the README
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "lsystem.h"
+#include "patterns.h"
+#include "renderlsystem.h"
+#include "simplegfx.h"
+#include "stats.h"
+#include "tools.h"
+
+/* Resolution of the hidden screen */
+#define BENCH_XRES 800
+#define BENCH_YRES 600
+/* Iterations are benchmarked until the string gets longer than this */
+#define BENCH_MAXSYMBOLS (1ul << 24)
+/* Highest iteration benchmarked for patterns that grow slowly */
+#define BENCH_MAXITER 12
+/* Every measurement is repeated and the fastest run is reported */
+#define BENCH_REPEAT 3
+/* Maximum number of patterns read from the README */
+#define BENCH_MAXPATTERNS 32
+
+/** Allocations made by genplant's code, counted by the linker wrappers */
+static unsigned long allocs = 0;
+static unsigned long allocBytes = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+void *__wrap_malloc(size_t size) {
+	allocs++;
+	allocBytes += size;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+	allocs++;
+	allocBytes += n * size;
+	return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+	allocs++;
+	allocBytes += size;
+	return __real_realloc(p, size);
+}
+
+/**
+ * Resets the peak resident memory of the process, where Linux allows it
+ */
+static void resetPeakRSS() {
+	FILE *f = fopen("/proc/self/clear_refs", "w");
+
+	if (f != NULL) {
+		fputs("5", f);
+		fclose(f);
+	}
+}
+
+/**
+ * Returns the peak resident memory in kB since the last reset, or 0 if
+ * it is not known
+ */
+static unsigned long peakRSS() {
+	FILE *f = fopen("/proc/self/status", "r");
+	char line[100];
+	unsigned long kb = 0;
+
+	if (f == NULL) {
+		return 0;
+	}
+	while (fgets(line, 100, f) != NULL) {
+		if (sscanf(line, "VmHWM: %lu kB", &kb) == 1) {
+			break;
+		}
+	}
+	fclose(f);
+	return kb;
+}
+
+/**
+ * Prints the hardware counters of a stage as JSON object, or null if
+ * they could not be read
+ */
+static void printCounts(const char *stage, PerfCounts *counts, bool last) {
+	static const char *names[PERF_EVENTS] = {"cycles", "instructions",
+		"cache_misses", "branch_misses"};
+	int i;
+
+	printf("\"%s\": ", stage);
+	if (!counts->valid) {
+		printf("null");
+	} else {
+		printf("{");
+		for (i = 0; i < PERF_EVENTS; i++) {
+			if (counts->values[i] < 0.) {
+				printf("\"%s\": null", names[i]);
+			} else {
+				printf("\"%s\": %.0f", names[i], counts->values[i]);
+			}
+			printf(i < PERF_EVENTS - 1 ? ", " : "}");
+		}
+	}
+	printf(last ? "}" : ",\n      ");
+}
+
+/**
+ * Benchmarks one iteration of a pattern and prints it as JSON object.
+ * Returns the derived string, which is the start of the next iteration.
+ */
+static char *benchIteration(Pattern *pattern, int iteration, char *lsys,
+		double linelength, bool first) {
+	Geometry *geo = geoNew();
+	View view = {1.f, BENCH_XRES / 2, BENCH_YRES};
+	Stats stats;
+	MemStats mem;
+	PerfCounts counts[STAT_STAGES];
+	RenderJob job;
+	char *next = NULL;
+	char *result;
+	double derive = HUGE_VAL;
+	double render = HUGE_VAL;
+	double interpret;
+	double raster = HUGE_VAL;
+	double t;
+	unsigned long pixels = 0;
+	unsigned long startAllocs;
+	unsigned long startBytes;
+	unsigned long runAllocs;
+	unsigned long runBytes;
+	size_t length;
+	int i;
+
+	resetPeakRSS();
+	memResetPeak();
+	startAllocs = allocs;
+	startBytes = allocBytes;
+
+	/* the times are taken without the statistics of the [I] overlay,
+	 * which are not free either */
+	statEnable(false);
+	for (i = 0; i < BENCH_REPEAT; i++) {
+		t = statNow();
+		result = lSystem(lsys, pattern->rule);
+		t = statNow() - t;
+		if (t < derive) {
+			derive = t;
+		}
+		if (next == NULL) {
+			next = result;
+		} else if (result != lsys) {
+			memFree(result);
+		}
+	}
+	length = strlen(next);
+
+	for (i = 0; i < BENCH_REPEAT; i++) {
+		/* the turtle together with the lines it draws */
+		sgClearScreen();
+		t = statNow();
+		renderBegin(&job, next, (int)linelength, pattern->angle, 0., &view,
+			geo);
+		renderStep(&job, job.length);
+		renderEnd(&job);
+		t = statNow() - t;
+		if (t < render) {
+			render = t;
+		}
+
+		/* all lines from the recorded geometry */
+		sgClearScreen();
+		t = statNow();
+		renderView(geo, &view);
+		t = statNow() - t;
+		if (t < raster) {
+			raster = t;
+		}
+	}
+	/* timing single lines is too inaccurate to take them out of the
+	 * turtle's time, so the time of drawing them all is subtracted */
+	interpret = render > raster ? render - raster : 0.;
+	runAllocs = (allocs - startAllocs) / BENCH_REPEAT;
+	runBytes = (allocBytes - startBytes) / BENCH_REPEAT;
+
+	/* one more pass of each stage with statistics for the pixels and
+	 * the hardware counters */
+	statEnable(true);
+	result = lSystem(lsys, pattern->rule);
+	statGet(&stats);
+	counts[STAT_DERIVE] = stats.counts[STAT_DERIVE];
+	if (result != lsys) {
+		memFree(result);
+	}
+	sgClearScreen();
+	statReset();
+	renderBegin(&job, next, (int)linelength, pattern->angle, 0., &view, geo);
+	renderStep(&job, job.length);
+	renderEnd(&job);
+	statGet(&stats);
+	counts[STAT_RENDER] = stats.counts[STAT_RENDER];
+	sgClearScreen();
+	statReset();
+	renderView(geo, &view);
+	statGet(&stats);
+	pixels = stats.pixels;
+	counts[STAT_RASTER] = stats.counts[STAT_RASTER];
+	statEnable(false);
+
+	printf("%s\n    {\"pattern\": \"%s\", \"angle\": %g, \"factor\": %d, "
+		"\"iteration\": %d,\n     \"symbols\": %lu, \"segments\": %d, "
+		"\"pixels\": %lu,\n", first ? "" : ",", pattern->rule,
+		pattern->angle, pattern->factor, iteration, (unsigned long)length,
+		geo->count, pixels);
+	printf("     \"derive_ms\": %.3f, \"derive_msymbols_s\": %.2f,\n"
+		"     \"interpret_ms\": %.3f, \"interpret_msegments_s\": %.2f,\n"
+		"     \"raster_ms\": %.3f, \"raster_mpixels_s\": %.2f,\n",
+		derive * 1e3, length / derive / 1e6,
+		interpret * 1e3, interpret > 0. ? geo->count / interpret / 1e6 : 0.,
+		raster * 1e3, raster > 0. ? pixels / raster / 1e6 : 0.);
+	memGetStats(&mem);
+	printf("     \"peak_rss_kb\": %lu, \"peak_heap_kb\": %lu, "
+		"\"allocs\": %lu, \"alloc_bytes\": %lu,\n     \"counters\": {",
+		peakRSS(),
+		mem.peak / 1024, runAllocs, runBytes);
+	printCounts("derive", &counts[STAT_DERIVE], false);
+	printCounts("render", &counts[STAT_RENDER], false);
+	printCounts("raster", &counts[STAT_RASTER], true);
+	printf("}");
+	fflush(stdout);
+
+	geoFree(geo);
+	return next;
+}
+
+/**
+ * Runs all patterns of the README given on the commandline and writes
+ * the results as JSON to stdout
+ */
+int main(int argc, char *argv[]) {
+	Pattern patterns[BENCH_MAXPATTERNS];
+	char *lsys;
+	char *next;
+	double linelength;
+	bool first = true;
+	int count;
+	int i;
+	int iteration;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s README > results.json\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	count = readPatterns(argv[1], patterns, BENCH_MAXPATTERNS);
+	if (count < 0) {
+		fprintf(stderr, "Couldn't open %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	if (count == 0) {
+		fprintf(stderr, "No patterns found in %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	if (sgInitHeadless("genplant bench", BENCH_XRES, BENCH_YRES) != 0) {
+		return EXIT_FAILURE;
+	}
+	statInit();
+	/* the counters are optional and only read in the measured pass */
+	perfOpen();
+
+	printf("{\"repeat\": %d, \"width\": %d, \"height\": %d, \"runs\": [",
+		BENCH_REPEAT, BENCH_XRES, BENCH_YRES);
+	for (i = 0; i < count; i++) {
+		fprintf(stderr, "%s -a %g -x %d\n", patterns[i].rule,
+			patterns[i].angle, patterns[i].factor);
+		lsys = newn(char, 2);
+		strcpy(lsys, "F");
+		linelength = 40.;
+		/* the first iteration is the axiom */
+		for (iteration = 2; iteration <= BENCH_MAXITER &&
+				lSysLength(lsys, patterns[i].rule) <= BENCH_MAXSYMBOLS;
+				iteration++) {
+			linelength *= ((double)patterns[i].factor/10.0);
+			next = benchIteration(&patterns[i], iteration, lsys,
+				linelength, first);
+			first = false;
+			if (next != lsys) {
+				memFree(lsys);
+			}
+			lsys = next;
+		}
+		memFree(lsys);
+	}
+	printf("\n]}\n");
+	perfClose();
+	SDL_Quit();
+	return 0;
+}
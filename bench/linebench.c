@@ -0,0 +1,253 @@
+/* linebench.c
+ * Microbenchmark of the line drawing
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "simplegfx.h"
+#include "stats.h"
+#include "tools.h"
+
+/* Size of the offscreen surface */
+#define LB_XRES 800
+#define LB_YRES 600
+/* Pixels drawn per pass, which sets the number of segments of a set */
+#define LB_PIXELS (1 << 21)
+/* Maximum number of segments in a set */
+#define LB_MAXSEGMENTS 100000
+/* Passes that are not measured, e.g. to fill the caches */
+#define LB_WARMUP 2
+/* Measured passes */
+#define LB_REPEAT 10
+
+/**
+ * A segment in screen coordinates
+ */
+typedef struct {
+	int x1, y1, x2, y2;
+} Line;
+
+/**
+ * A way of drawing lines. New rasterizers are added to the variants
+ * below, so they are measured on the same sets as the existing ones.
+ */
+typedef struct {
+	char *name;
+	void (*draw)(Line *lines, int count, Uint32 color);
+} Variant;
+
+/**
+ * Draws the lines with sgLine()
+ */
+static void drawLines(Line *lines, int count, Uint32 color) {
+	int i;
+
+	for (i = 0; i < count; i++) {
+		sgLine(lines[i].x1, lines[i].y1, lines[i].x2, lines[i].y2, color);
+	}
+}
+
+/**
+ * Draws the lines with sgLine() while the timing overlay is shown
+ */
+static void drawLinesStats(Line *lines, int count, Uint32 color) {
+	statEnable(true);
+	drawLines(lines, count, color);
+	statEnable(false);
+}
+
+static Variant variants[] = {
+	{"sgLine", drawLines},
+	{"sgLine+stats", drawLinesStats}
+};
+
+/**
+ * Returns a random number in [0, n)
+ */
+static int rnd(int n) {
+	return (int)(rand() / (RAND_MAX + 1.) * n);
+}
+
+/**
+ * Creates count segments of the given length. If octant is between 0
+ * and 7, all directions are within that octant, otherwise they are
+ * random. The given fraction of segments lies outside of the screen,
+ * and crossing of them start inside and end outside.
+ */
+static void makeLines(Line *lines, int count, int length, int octant,
+		double offscreen, double crossing) {
+	double ang;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (octant >= 0 && octant < 8) {
+			ang = (octant + rand() / (RAND_MAX + 1.)) * M_PI / 4.;
+		} else {
+			ang = rand() / (RAND_MAX + 1.) * 2. * M_PI;
+		}
+		if (i < count * offscreen) {
+			/* somewhere left of the screen */
+			lines[i].x1 = -length - 1 - rnd(LB_XRES);
+			lines[i].y1 = rnd(LB_YRES);
+		} else if (i < count * (offscreen + crossing)) {
+			/* close to the left or right edge, pointing outwards */
+			lines[i].x1 = rnd(2) ? rnd(8) : LB_XRES - 1 - rnd(8);
+			lines[i].y1 = rnd(LB_YRES);
+			ang = (rand() / (RAND_MAX + 1.) - .5) * M_PI / 2.;
+			if (lines[i].x1 < LB_XRES / 2) {
+				ang += M_PI;
+			}
+		} else {
+			/* inside, as far as the length allows */
+			lines[i].x1 = length < LB_XRES / 2 ?
+				length + rnd(LB_XRES - 2 * length) : LB_XRES / 2;
+			lines[i].y1 = length < LB_YRES / 2 ?
+				length + rnd(LB_YRES - 2 * length) : LB_YRES / 2;
+		}
+		lines[i].x2 = lines[i].x1 + (int)floor(cos(ang) * length + .5);
+		lines[i].y2 = lines[i].y1 + (int)floor(sin(ang) * length + .5);
+	}
+}
+
+/**
+ * Compares doubles for qsort()
+ */
+static int compareDoubles(const void *a, const void *b) {
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/**
+ * Measures all variants on one set of segments and prints a line for
+ * each of them
+ */
+static void benchSet(char *name, int bpp, Line *lines, int count) {
+	Uint32 white = sgCreateColor(255, 255, 255);
+	double times[LB_REPEAT];
+	double mean;
+	double sd;
+	double t;
+	unsigned long pixels;
+	Stats stats;
+	int v;
+	int i;
+
+	/* the same pixels are drawn by every variant */
+	sgClearScreen();
+	statReset();
+	drawLinesStats(lines, count, white);
+	statGet(&stats);
+	pixels = stats.pixels;
+
+	for (v = 0; v < (int)(sizeof(variants) / sizeof(variants[0])); v++) {
+		for (i = -LB_WARMUP; i < LB_REPEAT; i++) {
+			sgClearScreen();
+			t = statNow();
+			variants[v].draw(lines, count, white);
+			t = statNow() - t;
+			if (i >= 0) {
+				times[i] = t;
+			}
+		}
+		qsort(times, LB_REPEAT, sizeof(double), compareDoubles);
+		mean = 0.;
+		for (i = 0; i < LB_REPEAT; i++) {
+			mean += times[i];
+		}
+		mean /= LB_REPEAT;
+		sd = 0.;
+		for (i = 0; i < LB_REPEAT; i++) {
+			sd += (times[i] - mean) * (times[i] - mean);
+		}
+		sd = sqrt(sd / LB_REPEAT);
+
+		printf("%-14s %3d %-22s %7d %9lu %9.2f %9.2f %7.2f %8.3f\n",
+			variants[v].name, bpp, name, count, pixels,
+			times[0] * 1e9 / count, times[LB_REPEAT / 2] * 1e9 / count,
+			sd * 1e9 / count, pixels > 0 ? times[0] * 1e9 / pixels : 0.);
+	}
+	fflush(stdout);
+}
+
+/**
+ * Runs all sets of segments at all color depths
+ */
+int main(int argc, char *argv[]) {
+	static int depths[] = {8, 16, 24, 32};
+	static int lengths[] = {0, 1, 4, 16, 64, 256, 1000};
+	static double fractions[] = {0., .25, .5, .75, 1.};
+	Line *lines;
+	char name[30];
+	int count;
+	int d;
+	int i;
+
+	if (sgInitHeadless("genplant linebench", LB_XRES, LB_YRES) != 0) {
+		return EXIT_FAILURE;
+	}
+	lines = newn(Line, LB_MAXSEGMENTS);
+
+	printf("Times of the fastest and median of %d passes after %d warmup "
+		"passes\n\n", LB_REPEAT, LB_WARMUP);
+	printf("%-14s %3s %-22s %7s %9s %9s %9s %7s %8s\n", "variant", "bpp",
+		"set", "lines", "pixels", "ns/line", "median", "sd", "ns/pixel");
+	for (d = 0; d < (int)(sizeof(depths) / sizeof(depths[0])); d++) {
+		if (sgSetDepth(depths[d]) != 0) {
+			continue;
+		}
+		srand(1);
+
+		/* every direction */
+		for (i = 0; i < 8; i++) {
+			makeLines(lines, LB_PIXELS / 65, 64, i, 0., 0.);
+			sprintf(name, "octant %d, 64 px", i);
+			benchSet(name, depths[d], lines, LB_PIXELS / 65);
+		}
+
+		/* from single pixels to lines across the screen */
+		for (i = 0; i < (int)(sizeof(lengths) / sizeof(lengths[0])); i++) {
+			count = LB_PIXELS / (lengths[i] + 1);
+			if (count > LB_MAXSEGMENTS) {
+				count = LB_MAXSEGMENTS;
+			}
+			makeLines(lines, count, lengths[i], -1, 0., 0.);
+			sprintf(name, "%d px", lengths[i]);
+			benchSet(name, depths[d], lines, count);
+		}
+
+		/* lines that are rejected or clipped */
+		count = LB_PIXELS / 65;
+		for (i = 0; i < (int)(sizeof(fractions) / sizeof(fractions[0]));
+				i++) {
+			makeLines(lines, count, 64, -1, fractions[i], 0.);
+			sprintf(name, "%3.0f%% offscreen", fractions[i] * 100.);
+			benchSet(name, depths[d], lines, count);
+		}
+		makeLines(lines, count, 64, -1, 0., 1.);
+		benchSet("100% crossing the edge", depths[d], lines, count);
+	}
+
+	memFree(lines);
+	SDL_Quit();
+	return 0;
+}
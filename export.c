@@ -0,0 +1,326 @@
+/* export.c
+ * Export the segment buffer to a file on a background thread
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <string.h>
+#include "SDL.h"
+#include "export.h"
+#include "writer.h"
+#include "meshexport.h"
+#include "svgexport.h"
+#include "trace.h"
+#include "tools.h"
+
+/* minimum time between two progress events in ms */
+#define EXPORT_EVENT_INTERVAL 100
+
+/** The running export thread */
+static SDL_Thread *thread;
+/** Protects status */
+static SDL_mutex *lock;
+static ExportStatus status;
+/** The snapshot that is being exported, owned by the export thread */
+static Geometry *snapshot;
+static ExportOptions options;
+/** Start time of the running export */
+static Uint32 start;
+
+/**
+ * Wakes up the main loop so it can redraw the export status
+ */
+static void notify() {
+	SDL_Event event;
+
+	event.type = SDL_USEREVENT;
+	event.user.code = EXPORT_EVENT;
+	event.user.data1 = NULL;
+	event.user.data2 = NULL;
+	SDL_PushEvent(&event);
+}
+
+/**
+ * Updates the shared status. Must be called with the lock held.
+ */
+static void updateStatus(Writer *w, int done, int total) {
+	Uint32 now = SDL_GetTicks();
+
+	status.progress = total > 0 ? (double)done / total : 1.;
+	status.bytes = w->written;
+	status.throughput = now > start ?
+		w->written / ((now - start) / 1000.) : 0.;
+}
+
+/**
+ * Called by the exporters to publish their progress. The main loop is
+ * notified at most every EXPORT_EVENT_INTERVAL ms.
+ */
+void exportProgress(Writer *w, int done, int total) {
+	static Uint32 last = 0;
+	Uint32 now = SDL_GetTicks();
+
+	if (now - last < EXPORT_EVENT_INTERVAL) {
+		return;
+	}
+	last = now;
+
+	SDL_mutexP(lock);
+	updateStatus(w, done, total);
+	SDL_mutexV(lock);
+	notify();
+}
+
+#ifdef VRML
+/**
+ * Print out the header for the VRML export
+ */
+static void writeVRMLHeader(Writer *w) {
+	int i;
+	static char *header[] = {
+		"#VRML V2.0 utf8",
+		"",
+		"PROTO Plant [",
+		"	exposedField SFNode plantmat Material {",
+		"		diffuseColor 0 0.5 0",
+		"	}",
+		"] {",
+		"	Transform {",
+		"		children [",
+		"			DEF branch Transform {",
+		"				children Shape {",
+		"					geometry Box {",
+		"						size 2 20 2",
+		"					}",
+		"					appearance Appearance {",
+		"						material IS plantmat",
+		"					}",
+		"				}",
+		"			}",
+		"			DEF TS1 TimeSensor {",
+		"				enabled TRUE",
+		"				loop TRUE",
+		"				cycleInterval 1.35",
+		"			}",
+		"			DEF OI1 OrientationInterpolator {",
+		"				key [ 0, 0.5, 1.0 ]",
+		"				keyValue [",
+		"					0 1 0 -0.5",
+		"					0 1 0 -1.0",
+		"					0 1 0 -0.6",
+		"				]",
+		"			}"};
+	for (i = 0; i < 32; i++) {
+		wrPuts(w, header[i]);
+		wrPuts(w, "\n");
+	}
+}
+
+/**
+ * Writes the segment buffer as nested VRML transforms: each segment
+ * is a branch rotated relative to its parent.
+ */
+static void writeVRML(Writer *w, Geometry *geo) {
+	int openTransforms = 0;
+	int i;
+	int j;
+	Segment *seg;
+
+	writeVRMLHeader(w);
+	for (i = 0; i < geo->count; i++) {
+		seg = &geo->segs[i];
+		for (j = seg->closes; j > 0 && openTransforms > 0; j--) {
+			openTransforms--;
+			wrPuts(w, "]}\n");
+		}
+		wrPuts(w,
+			"	Transform {\n"
+			"		translation 0 18 0\n"
+			"		rotation 0 0 1 ");
+		wrDouble(w, seg->rotation * geo->angle, 6);
+		wrPuts(w, "\n"
+			"		center 0 -9 0\n"
+			"		children [\n"
+			"			USE branch\n");
+		openTransforms++;
+		exportProgress(w, i, geo->count);
+	}
+	for (j = geo->closes; j > 0 && openTransforms > 0; j--) {
+		openTransforms--;
+		wrPuts(w, "]}\n");
+	}
+	for (i = openTransforms + 1; i > 0; i--) {
+		wrPuts(w, "]} ");
+	}
+	wrPuts(w, "	ROUTE TS1.fraction_changed TO OI1.set_fraction\n");
+	wrPuts(w, "	ROUTE OI1.value_changed TO branch.rotation\n");
+	wrPuts(w, "}\n");
+}
+#endif
+
+/**
+ * Thread function: writes the snapshot and frees it
+ */
+static int exportThread(void *unused) {
+	Writer *w;
+	bool ok = false;
+	double span;
+
+	traceThreadName("export");
+	span = traceBegin();
+	w = wrOpen(options.filename, exportCompressed(options.filename));
+	if (w != NULL) {
+		switch (exportFormat(options.filename)) {
+			case EXP_PLY:
+				writePLY(w, snapshot, options.tubeWidth);
+				break;
+			case EXP_GLB:
+				writeGLB(w, snapshot, options.tubeWidth);
+				break;
+			case EXP_SVG:
+				writeSVG(w, snapshot, options.tolerance);
+				break;
+			default:
+#ifdef VRML
+				writeVRML(w, snapshot);
+#else
+				fprintf(stderr, "VRML export is not compiled in\n");
+				w->failed = true;
+#endif
+				break;
+		}
+		SDL_mutexP(lock);
+		updateStatus(w, snapshot->count, snapshot->count);
+		SDL_mutexV(lock);
+		ok = wrClose(w);
+	}
+	geoFree(snapshot);
+	snapshot = NULL;
+	traceEnd("export", span);
+
+	SDL_mutexP(lock);
+	status.active = false;
+	status.failed = !ok;
+	SDL_mutexV(lock);
+	notify();
+	return ok ? 0 : 1;
+}
+
+/**
+ * Checks if ext starts with the extension name, followed by the end of
+ * the file name or another extension
+ */
+static bool isExtension(char *ext, char *name) {
+	size_t n = strlen(name);
+
+	return ext != NULL && strncmp(ext, name, n) == 0
+		&& (ext[n] == '\0' || ext[n] == '.');
+}
+
+/**
+ * Checks if an export file should be gzip compressed: .gz files and
+ * compressed VRML (.wrz)
+ */
+bool exportCompressed(char *filename) {
+	char *ext = strrchr(filename, '.');
+
+	return ext != NULL &&
+		(strcmp(ext, ".gz") == 0 || strcmp(ext, ".wrz") == 0);
+}
+
+/**
+ * Returns the format of an export file, guessed from its extension.
+ * For compressed files the extension before .gz is used.
+ */
+int exportFormat(char *filename) {
+	char *ext = strrchr(filename, '.');
+
+	if (ext != NULL && strcmp(ext, ".gz") == 0) {
+		do {
+			ext--;
+		} while (ext > filename && *ext != '.');
+	}
+
+	if (isExtension(ext, ".ply")) {
+		return EXP_PLY;
+	}
+	if (isExtension(ext, ".glb")) {
+		return EXP_GLB;
+	}
+	if (isExtension(ext, ".svg")) {
+		return EXP_SVG;
+	}
+	return EXP_VRML;
+}
+
+/**
+ * Starts exporting a snapshot of the geometry in the background. The
+ * exporter takes ownership of geo. Returns false if an export is still
+ * running.
+ */
+bool exportStart(Geometry *geo, ExportOptions *opts) {
+	if (lock == NULL) {
+		lock = SDL_CreateMutex();
+	}
+	SDL_mutexP(lock);
+	if (status.active) {
+		SDL_mutexV(lock);
+		geoFree(geo);
+		return false;
+	}
+	status.active = true;
+	status.failed = false;
+	status.filename = opts->filename;
+	status.progress = 0.;
+	status.throughput = 0.;
+	status.bytes = 0;
+	SDL_mutexV(lock);
+
+	/* reap the previous, finished thread */
+	if (thread != NULL) {
+		SDL_WaitThread(thread, NULL);
+	}
+	snapshot = geo;
+	options = *opts;
+	start = SDL_GetTicks();
+	thread = SDL_CreateThread(exportThread, NULL);
+	return true;
+}
+
+/**
+ * Copies the current export status
+ */
+void exportGetStatus(ExportStatus *st) {
+	if (lock == NULL) {
+		memset(st, 0, sizeof(ExportStatus));
+		return;
+	}
+	SDL_mutexP(lock);
+	*st = status;
+	SDL_mutexV(lock);
+}
+
+/**
+ * Blocks until a running export has finished
+ */
+void exportWait() {
+	if (thread != NULL) {
+		SDL_WaitThread(thread, NULL);
+		thread = NULL;
+	}
+}
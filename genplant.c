@@ -27,9 +27,30 @@
 #include "renderlsystem.h"
 #include "simplegfx.h"
 #include "input.h"
+#include "geometry.h"
+#include "animate.h"
+#include "grid.h"
+#include "export.h"
+#include "speculate.h"
+#include "history.h"
+#include "video.h"
+#include "stats.h"
+#include "latency.h"
+#include "trace.h"
 #include "tools.h"
 
 #define TITLE "genplant v0.3"
+/* L-Systems longer than this get a coarse preview while rendering */
+#define PREVIEW_SYMBOLS 50000
+/* Zoom factor of one step of the mouse wheel */
+#define ZOOM_STEP 1.25f
+/* Limits of the zoom, so that screen coordinates fit into an int */
+#define ZOOM_MIN (1.f/256.f)
+#define ZOOM_MAX 256.f
+/* A right click inspects segments up to this many pixels away */
+#define INSPECT_RADIUS 8.f
+/* Number of symbols shown for an inspected segment */
+#define INSPECT_SYMBOLS 32
 
 /**
  * Prints the command line options to stdout
@@ -37,17 +58,44 @@
 void outputHelp() {
 	printf("%s - Andreas Textor\n", TITLE);
 	printf(
-		"Usage: genplant [-h|--help][-f][-s L-System][-t][-a angle]\n"
-		"       [-l length][-x factor]\n\n"
+		"Usage: genplant [-h|--help][-f][-r WxH][-s L-System][-t]\n"
+		"       [-a angle][-l length][-x factor]\n\n"
 		"Options:\n"
 		"-h  --help  - Show this help screen\n"
 		"-f          - Enable fullscreen\n"
+		"-r <WxH>    - Resolution, e.g. -r 1920x1080 (default: 800x600)\n");
+	printf(
 		"-t          - Print the state of the L-System (default: off)\n"
 		"-a <angle>  - Set angle in degrees (default: 20)\n"
 		"-l <length> - Initial line length in pixels (default: 40)\n"
 		"-x <factor> - Contraction-factor, e.g. -x 7 will multiply the "
 		"line-length\n              with 0.7 at each iteration "
 		"(default: 7)\n");
+	printf(
+		"-o <file>   - Export file, the format is chosen by the extension:\n"
+		"              .wrl (VRML), .ply, .glb, .svg (default: genplant.wrl)\n"
+		"              .wrz and .gz files are gzip compressed\n"
+		"-w <width>  - Export branches to .ply/.glb as tubes of this width\n"
+		"              instead of lines\n"
+		"-tol <px>   - Simplify .svg paths by up to this many pixels\n");
+	printf(
+		"-y <file>   - Record a video of the plant growing as YUV4MPEG2\n"
+		"              stream instead of opening a window, - for stdout\n"
+		"-n <count>  - Iterations of the recorded plant (default: 1)\n"
+		"-sweep <angle> - Record the angle changing by this many degrees\n"
+		"              instead of the growth\n");
+	printf(
+		"-trace <file> - Write the time spent in each stage as Chrome trace,\n"
+		"              which can be viewed in Perfetto\n"
+		"-perf       - Show hardware counters with the timing ([I], Linux)\n"
+		"-latency <file> - Write the time from input until it is shown\n"
+		"              when exiting, - for stdout\n"
+		"-replay <file> - Run the input script without a window and print\n"
+		"              how long each step took\n");
+	printf(
+		"-m <MB>     - Memory budget for deriving the next iteration in\n"
+		"              advance (default: 256, 0 disables it)\n"
+		"-c <MB>     - Memory for previous iterations (default: 512)\n");
 	printf(
 		"-s L-System - set L-System\n"
 		"-ax axiom   - set axiom (default: F)\n\n"
@@ -71,17 +119,252 @@ void drawHelp(bool complete) {
 			"[S] - Decrease angle\n"
 			"[R] - Increase angle randomization\n"
 			"[T] - Reset angle randomization\n"
-			"[O] - Reset movement\n"
-#ifdef VRML
-			"[M] - Export VRML\n"
-#endif
+			"[O] - Reset movement and zoom\n"
+			"[M] - Export\n"
 			"[Arrow Keys] - Move around\n"
-			"[SPACE] - Next iteration", 10, 20, white);
+			"[Drag] - Move around\n"
+			"[Mouse wheel] - Zoom\n"
+			"[Right click] - Inspect branch\n"
+			"[G] - Grow the plant branch by branch\n"
+			"[D] - Replay the drawing of the plant\n"
+			"[I] - Show timing and memory\n"
+			"[SPACE] - Next iteration\n"
+			"[BACKSPACE] - Previous iteration", 10, 20, white);
 	} else {
 		sgDrawText("[H] - Display Help", 10, 20, white);
 	}
 }
 
+/**
+ * Displays the progress of a running export or the result of the last one
+ */
+void drawExportStatus() {
+	Uint32 green = sgCreateColor(0, 255, 0);
+	ExportStatus status;
+	char text[100];
+
+	exportGetStatus(&status);
+	if (status.filename == NULL) {
+		return;
+	}
+	if (status.active) {
+		snprintf(text, 100, "Exporting %s: %3.0f%%  %.1f MB/s",
+			status.filename, status.progress * 100.,
+			status.throughput / (1024. * 1024.));
+	} else if (status.failed) {
+		snprintf(text, 100, "Export to %s failed", status.filename);
+	} else {
+		snprintf(text, 100, "Exported %s (%.1f MB)", status.filename,
+			status.bytes / (1024. * 1024.));
+	}
+	sgDrawText(text, 10, SG_TEXTLINE(1), green);
+}
+
+/**
+ * Draws the texts on top of the plant
+ */
+void drawOverlay(int iteration, char *lsys, bool drawText, bool help) {
+	Uint32 white = sgCreateColor(255, 255, 255);
+	char output[15];
+
+	snprintf(output, 15, "Iteration: %d", iteration);
+	sgDrawText(output, sgWidth() - 130, SG_TEXTLINE(0), white);
+	if (drawText) {
+		sgDrawText(lsys, 10, 10, white);
+	}
+	drawHelp(help);
+	drawExportStatus();
+}
+
+/**
+ * Appends the hardware counters of a stage to text. The misses are per
+ * thousand instructions.
+ */
+void formatCounts(char *text, size_t n, char *stage, PerfCounts *counts) {
+	double *v = counts->values;
+	size_t len = strlen(text);
+
+	if (!counts->valid || v[PERF_CYCLES] < 0. || v[PERF_INSTRUCTIONS] <= 0.) {
+		snprintf(text + len, n - len, "\n%-9s        -", stage);
+		return;
+	}
+	snprintf(text + len, n - len, "\n%-9s %8.1f %5.2f %8.2f %9.2f", stage,
+		v[PERF_CYCLES] / 1e6, v[PERF_INSTRUCTIONS] / v[PERF_CYCLES],
+		v[PERF_CACHEMISSES] * 1e3 / v[PERF_INSTRUCTIONS],
+		v[PERF_BRANCHMISSES] * 1e3 / v[PERF_INSTRUCTIONS]);
+}
+
+/**
+ * Displays how long each stage of the last frame took and how much
+ * memory the plant needs
+ */
+void drawStats(Geometry *geo, size_t length) {
+	Uint32 yellow = sgCreateColor(255, 255, 0);
+	Stats stats;
+	MemStats mem;
+	char text[600];
+
+	statGet(&stats);
+	memGetStats(&mem);
+	snprintf(text, 600,
+		"Derive    %7.1f ms %7.2f M sym/s\n"
+		"Interpret %7.1f ms %7.2f M seg/s\n"
+		"Raster    %7.1f ms %7.2f M pixels\n"
+		"Text      %7.1f ms\n"
+		"String    %7.1f MB\n"
+		"Geometry  %7.1f MB\n"
+		"Heap      %7.1f MB %7.1f MB peak\n"
+		"Allocs    %7lu    %7lu total\n"
+		"RSS       %7.1f MB",
+		stats.derive * 1e3,
+		stats.derive > 0. ? stats.symbols / stats.derive / 1e6 : 0.,
+		stats.interpret * 1e3,
+		stats.interpret > 0. ? stats.segments / stats.interpret / 1e6 : 0.,
+		stats.raster * 1e3, stats.pixels / 1e6,
+		stats.text * 1e3,
+		(length + 1) / (1024. * 1024.),
+		geo->capacity * sizeof(Segment) / (1024. * 1024.),
+		mem.live / (1024. * 1024.), mem.peak / (1024. * 1024.),
+		stats.allocs, mem.calls,
+		statRSS() / (1024. * 1024.));
+	if (!perfOwned()) {
+		sgDrawText(text, sgWidth() - 280, 20, yellow);
+		return;
+	}
+	strcat(text, "\n\nCounters   Mcycles   IPC cache/ki branch/ki");
+	formatCounts(text, 600, "Derive", &stats.counts[STAT_DERIVE]);
+	formatCounts(text, 600, "Render", &stats.counts[STAT_RENDER]);
+	formatCounts(text, 600, "Raster", &stats.counts[STAT_RASTER]);
+	sgDrawText(text, sgWidth() - 360, 20, yellow);
+}
+
+/**
+ * Displays which symbol of the L-System drew the inspected segment
+ */
+void drawInspection(char *lsys, Geometry *geo, int inspected) {
+	Uint32 red = sgCreateColor(255, 64, 64);
+	char text[100];
+	int symbol = geo->segs[inspected].symbol;
+
+	snprintf(text, 100, "Segment %d of %d, symbol %d: %.*s%s", inspected,
+		geo->count, symbol, INSPECT_SYMBOLS, lsys + symbol,
+		memchr(lsys + symbol, '\0', INSPECT_SYMBOLS + 1) ? "" : "...");
+	sgDrawText(text, 10, SG_TEXTLINE(2), red);
+}
+
+/**
+ * Returns the highest cached iteration below the given one that is
+ * short enough for a quick preview, or NULL if there is none. The
+ * line length is scaled back accordingly.
+ */
+char *findPreview(int iteration, int factor, double *linelength) {
+	char *preview;
+	int i;
+
+	for (i = iteration - 1; i >= 1; i--) {
+		if (factor > 0) {
+			*linelength /= ((double)factor/10.0);
+		}
+		preview = histGet(i);
+		if (preview != NULL && strlen(preview) <= PREVIEW_SYMBOLS) {
+			return preview;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Returns true if the input only changes the view of the plant, so the
+ * recorded geometry can be reused
+ */
+bool isViewChange(int input) {
+	return input == INP_INCXOFFSET || input == INP_DECXOFFSET ||
+		input == INP_INCYOFFSET || input == INP_DECYOFFSET ||
+		input == INP_RESETOFFSET || input == INP_DRAG ||
+		input == INP_ZOOMIN || input == INP_ZOOMOUT || input == INP_INSPECT ||
+		input == INP_RESIZE || input == INP_GROW || input == INP_REPLAY ||
+		input == INP_TOGGLESTATS;
+}
+
+/**
+ * Puts the starting point of the plant to the bottom center of the
+ * screen without zoom
+ */
+void resetView(View *view) {
+	view->zoom = 1.f;
+	view->offsetX = sgWidth() / 2;
+	view->offsetY = sgHeight();
+}
+
+/**
+ * Zooms the view by the given factor, keeping the point under the mouse
+ * at the same place
+ */
+void zoomView(View *view, int x, int y, float factor) {
+	if (view->zoom * factor < ZOOM_MIN || view->zoom * factor > ZOOM_MAX) {
+		return;
+	}
+	view->offsetX = x - (int)((x - view->offsetX) * factor);
+	view->offsetY = y - (int)((y - view->offsetY) * factor);
+	view->zoom *= factor;
+}
+
+/**
+ * Records a video without opening a window, either of the plant growing
+ * or of the angle sweeping by the given amount
+ */
+int recordVideo(char *filename, char *lsys, double linelength, double angle,
+		double randomizeAngle, double sweep, int width, int height) {
+	Geometry *geo = geoNew();
+	Animation anim;
+	Video *video;
+	View view;
+	int frames = ANIM_DURATION * ANIM_FPS / 1000;
+	unsigned int seed = (unsigned)time(NULL);
+	int i;
+
+	if (sgInitHeadless(TITLE, width, height) != 0) {
+		return EXIT_FAILURE;
+	}
+	video = videoOpen(filename, width, height, ANIM_FPS);
+	if (video == NULL) {
+		return EXIT_FAILURE;
+	}
+	resetView(&view);
+
+	if (sweep == 0.) {
+		renderLSystem(lsys, (int)linelength, angle, randomizeAngle, &view,
+			geo);
+		animStart(&anim, geo, lsys, &view, ANIM_DEPTH);
+	}
+	for (i = 0; i <= frames; i++) {
+		if (sweep == 0.) {
+			animFrameAt(&anim, i * 1000 / ANIM_FPS);
+		} else {
+			/* the same randomization in every frame, so only the angle
+			 * changes */
+			srand(seed);
+			sgClearScreen();
+			renderLSystem(lsys, (int)linelength,
+				angle + sweep * i / frames, randomizeAngle, &view, geo);
+		}
+		/* the writer thread stores the previous frame meanwhile */
+		videoFrame(video, SDL_GetVideoSurface());
+	}
+	if (sweep == 0.) {
+		animEnd(&anim);
+	}
+	geoFree(geo);
+
+	i = video->frames;
+	if (!videoClose(video)) {
+		return EXIT_FAILURE;
+	}
+	fprintf(stderr, "Recorded %d frames to %s\n", i, filename);
+	SDL_Quit();
+	return 0;
+}
+
 /**
  * Main function: checks commandline, initializes graphics output
  * and goes into main loop
@@ -91,23 +374,47 @@ int main(int argc, char *argv[]) {
 	bool running = true;
 	bool fullscreen = false;
 	bool help = true;
-#ifdef VRML
-	bool exportVRML = false;
-#endif
-	Uint32 color;
+	bool showStats = false;
+	bool complete = false;
+	bool repaint = false;
+	bool grown;
+	bool redraw;
 	char *lpreset = "F[+F]F[-F][F]";
 	char *fto = lpreset;
 	char *lsys = NULL;
-	char *output;
+	char *next;
+	char *preview;
+	ExportOptions exportOptions = {"genplant.wrl", 0., 0.};
+	Geometry *geo = geoNew();
+	Grid *grid = NULL;
+	RenderJob job;
+	Animation anim;
+	int animation = -1;
 	int input;
 	int i;
 	int iteration = 1;
+	int iterations = 1;
 	int factor = 7;
-	int offsetX = XRES / 2;
-	int offsetY = YRES;
+	int mouseX;
+	int mouseY;
+	int inspected = -1;
+	int highlighted = -1;
+	int dx;
+	int dy;
+	int width = DEFAULT_XRES;
+	int height = DEFAULT_YRES;
+	View view;
+	View drawn;
 	double linelength = 40.;
 	double angle = 20.;
 	double randomizeAngle = 0.;
+	double previewLength;
+	double sweep = 0.;
+	char *videoFile = NULL;
+	char *traceFile = NULL;
+	char *latencyFile = NULL;
+	char *replayFile = NULL;
+	bool counters = false;
 
 	/* check commandline */
 	for (i = 0; i < argc; i++) {
@@ -117,14 +424,13 @@ int main(int argc, char *argv[]) {
 		}
 		if (strcmp(argv[i], "-s") == 0) {
 			if(argc-1 > i) {
-				fto = newn(char, strlen(argv[i+1]));
-				strncpy(fto, argv[i+1], strlen(argv[i+1]));
+				fto = argv[i+1];
 			}
 		}
 		if (strcmp(argv[i], "-ax") == 0) {
 			if(argc-1 > i) {
-				lsys = newn(char, strlen(argv[i+1]));
-				strncpy(lsys, argv[i+1], strlen(argv[i+1]));
+				lsys = newn(char, strlen(argv[i+1]) + 1);
+				strcpy(lsys, argv[i+1]);
 			}
 		}
 		if (strcmp(argv[i], "-x") == 0) {
@@ -137,113 +443,420 @@ int main(int argc, char *argv[]) {
 				linelength = (double)atoi(argv[i+1]);
 			}
 		}
+		if (strcmp(argv[i], "-o") == 0) {
+			if(argc-1 > i) {
+				exportOptions.filename = argv[i+1];
+			}
+		}
+		if (strcmp(argv[i], "-w") == 0) {
+			if(argc-1 > i) {
+				exportOptions.tubeWidth = atof(argv[i+1]);
+			}
+		}
+		if (strcmp(argv[i], "-tol") == 0) {
+			if(argc-1 > i) {
+				exportOptions.tolerance = atof(argv[i+1]);
+			}
+		}
+		if (strcmp(argv[i], "-m") == 0) {
+			if(argc-1 > i) {
+				specSetBudget((unsigned long)atoi(argv[i+1]) << 20);
+			}
+		}
+		if (strcmp(argv[i], "-c") == 0) {
+			if(argc-1 > i) {
+				histSetBudget((unsigned long)atoi(argv[i+1]) << 20);
+			}
+		}
 		if (strcmp(argv[i], "-a") == 0) {
 			if(argc-1 > i) {
 				angle = (double)atoi(argv[i+1]);
 			}
 		}
+		if (strcmp(argv[i], "-y") == 0) {
+			if(argc-1 > i) {
+				videoFile = argv[i+1];
+			}
+		}
+		if (strcmp(argv[i], "-trace") == 0) {
+			if(argc-1 > i) {
+				traceFile = argv[i+1];
+			}
+		}
+		if (strcmp(argv[i], "-latency") == 0) {
+			if(argc-1 > i) {
+				latencyFile = argv[i+1];
+			}
+		}
+		if (strcmp(argv[i], "-replay") == 0) {
+			if(argc-1 > i) {
+				replayFile = argv[i+1];
+			}
+		}
+		if (strcmp(argv[i], "-perf") == 0) {
+			counters = true;
+		}
+		if (strcmp(argv[i], "-n") == 0) {
+			if(argc-1 > i) {
+				iterations = atoi(argv[i+1]);
+			}
+		}
+		if (strcmp(argv[i], "-sweep") == 0) {
+			if(argc-1 > i) {
+				sweep = atof(argv[i+1]);
+			}
+		}
 		if (strcmp(argv[i], "-t") == 0) {
 			drawText = true;
 		}
 		if (strcmp(argv[i], "-f") == 0) {
 			fullscreen = true;
 		}
+		if (strcmp(argv[i], "-r") == 0) {
+			if(argc-1 > i && (sscanf(argv[i+1], "%dx%d", &width,
+					&height) != 2 || width <= 0 || height <= 0)) {
+				fprintf(stderr, "Invalid resolution: %s\n", argv[i+1]);
+				exit(EXIT_FAILURE);
+			}
+		}
 	}
 	
-	/* create screen */
-	if (sgInit(fullscreen, TITLE) != 0) {
-		exit(EXIT_FAILURE);
+	if (traceFile != NULL) {
+		traceStart();
+	}
+	if (counters) {
+		perfOpen();
 	}
-	color = sgCreateColor(255, 255, 255);
 
 	/* create L-system */
 	if (lsys == NULL) {
 		lsys = newn(char, 2);
-		lsys = "F";
+		strcpy(lsys, "F");
+	}
+
+	if (videoFile != NULL) {
+		next = lSysIterate(lsys, fto, iterations - 1);
+		for (i = 1; i < iterations; i++) {
+			linelength *= ((double)factor/10.0);
+		}
+		i = recordVideo(videoFile, next, linelength, angle, randomizeAngle,
+			sweep, width, height);
+		if (next != lsys) {
+			memFree(next);
+		}
+		memFree(lsys);
+		geoFree(geo);
+		if (traceFile != NULL && !traceWrite(traceFile)) {
+			i = EXIT_FAILURE;
+		}
+		return i;
 	}
 
-	/* allocate memory for output string */
-	output = newn(char, 15);
+	/* create screen, a script is replayed on a hidden one */
+	if (replayFile != NULL) {
+		if (sgInitHeadless(TITLE, width, height) != 0 ||
+				!inputScript(replayFile)) {
+			exit(EXIT_FAILURE);
+		}
+	} else if (sgInit(fullscreen, TITLE, width, height) != 0) {
+		exit(EXIT_FAILURE);
+	}
+	resetView(&view);
+	/* the history owns all derived strings */
+	lsys = histAdd(iteration, lsys);
 
-	srand((unsigned)time(NULL));
+	/* replays draw the same random angles every time */
+	srand(replayFile != NULL ? 1 : (unsigned)time(NULL));
+	statInit();
+	if (latencyFile != NULL) {
+		latencyEnable();
+	}
 
 	/* display L-system */
 	while (running) {
-		sgClearScreen();
-		snprintf(output, 15, "Iteration: %d", iteration);
-		sgDrawText(output, 670, 580, color);
-#ifdef VRML
-		renderLSystem(lsys, (int)linelength, angle, randomizeAngle,
-			offsetX, offsetY, exportVRML);
-		exportVRML = false;
-#else
-		renderLSystem(lsys, (int)linelength, angle, randomizeAngle,
-			offsetX, offsetY);
-#endif
-		if (drawText) {
-			sgDrawText(lsys, 10, 10, color);
-		}
-		drawHelp(help);
-		sgUpdateScreen();
+		statReset();
+		/* only the view changed, so the recorded plant can be kept */
+		if (complete) {
+			if (grid == NULL) {
+				grid = gridNew(geo);
+			}
+			if (animation >= 0) {
+				/* replay the recorded segments, the turtle is not needed */
+				animStart(&anim, geo, lsys, &view, animation);
+				do {
+					grown = animFrame(&anim);
+					sgUpdateScreen();
+					latencyPresented();
+					if (!grown) {
+						animWait(&anim);
+					}
+				} while (!grown && !inputPending());
+				animEnd(&anim);
+				animation = -1;
+				/* an interrupted animation leaves half a plant behind */
+				repaint = !grown;
+			} else if (view.zoom != drawn.zoom || repaint) {
+				/* zooming needs all segments, but not the turtle */
+				sgClearScreen();
+				renderView(geo, &view);
+				repaint = false;
+			} else {
+				if (highlighted >= 0) {
+					renderUnhighlight(grid, &drawn, &geo->segs[highlighted]);
+				}
+				renderPan(grid, &drawn, &view);
+			}
+			drawn = view;
+			highlighted = inspected;
+			if (inspected >= 0) {
+				renderHighlight(&geo->segs[inspected], &view,
+					sgCreateColor(255, 64, 64));
+			}
+			renderStatus(&job);
+			drawOverlay(iteration, lsys, drawText, help);
+			if (showStats) {
+				drawStats(geo, job.length);
+			}
+			if (inspected >= 0) {
+				drawInspection(lsys, geo, inspected);
+			}
+			sgUpdateScreen();
+			latencyPresented();
+		} else {
+			/* show a lower iteration first if the plant takes long to draw */
+			previewLength = linelength;
+			preview = NULL;
+			if (strlen(lsys) > PREVIEW_SYMBOLS) {
+				preview = findPreview(iteration, factor, &previewLength);
+			}
+			if (preview != NULL) {
+				sgClearScreen();
+				renderLSystem(preview, (int)previewLength, angle,
+					randomizeAngle, &view, geo);
+				drawOverlay(iteration, lsys, drawText, help);
+				sgUpdateScreen();
+				latencyPresented();
+			}
+
+			/* render in chunks off screen and give up as soon as there is
+			 * new input, which would make this rendering obsolete anyway */
+			sgClearScreen();
+			renderBegin(&job, lsys, (int)linelength, angle, randomizeAngle,
+				&view, geo);
+			do {
+				complete = renderStep(&job, RENDER_CHUNK);
+			} while (!complete && !inputPending());
+			renderEnd(&job);
+			if (complete) {
+				renderStatus(&job);
+				drawOverlay(iteration, lsys, drawText, help);
+				if (showStats) {
+					drawStats(geo, job.length);
+				}
+				sgUpdateScreen();
+				latencyPresented();
+				/* derive the next iteration while the user looks at this
+				 * one */
+				specStart(lsys, fto);
+				/* index the segments for moving and inspecting */
+				grid = gridStart(geo);
+			}
+			drawn = view;
+			highlighted = -1;
+			repaint = false;
+		}
+
 		do {
-			input = INP_NULL;
+			redraw = false;
 			input = checkInput();
-			switch (input) {
-				case INP_QUIT:
-					running = false;
-					break;
-				case INP_CONT:
-					iteration++;
-					lsys = lSystem(lsys, fto);
-					linelength *= ((double)factor/10.0);
-					break;
-				case INP_TOGGLEHELP:
-					help = !help;
-					break;
-				case INP_INCANGLE:
-					angle += 5.;
-					break;
-				case INP_DECANGLE:
-					angle -= 5.;
-					break;
-				case INP_INCLINELEN:
-					linelength += 3;
-					break;
-				case INP_DECLINELEN:
-					linelength -= 3;
-					break;
-				case INP_INCRANDANGLE:
-					randomizeAngle += 1.;
-					break;
-				case INP_RESETRANDANGLE:
-					randomizeAngle = 0.;
-					break;
-				case INP_DECYOFFSET:
-					offsetY -= (int)linelength;
-					break;
-				case INP_INCYOFFSET:
-					offsetY += (int)linelength;
-					break;
-				case INP_DECXOFFSET:
-					offsetX -= (int)linelength;
-					break;
-				case INP_INCXOFFSET:
-					offsetX += (int)linelength;
-					break;
-				case INP_RESETOFFSET:
-					offsetX = XRES / 2;
-					offsetY = YRES;
-					break;
-#ifdef VRML
-				case INP_EXPORTVRML:
-					exportVRML = true;
-					break;
-#endif
-				default:
-					break;
-			}
-		} while (input == INP_NULL);
+			/* apply everything that queued up while rendering as one
+			 * batch, so the plant is only drawn once for it */
+			while (input != INP_NULL && running) {
+				switch (input) {
+					case INP_QUIT:
+						running = false;
+						break;
+					case INP_CONT:
+						/* iterations that were already shown are
+						 * cached */
+						next = histGet(iteration + 1);
+						if (next == NULL) {
+							next = histAdd(iteration + 1,
+								specTake(lsys, fto));
+						}
+						iteration++;
+						lsys = next;
+						linelength *= ((double)factor/10.0);
+						break;
+					case INP_BACK:
+						if (iteration <= 1) {
+							if (!complete) {
+								redraw = true;
+							}
+							input = INP_NULL;
+							break;
+						}
+						/* the speculation reads the current string,
+						 * which may be evicted from the history */
+						specCancel();
+						iteration--;
+						lsys = histFetch(iteration, fto);
+						if (factor > 0) {
+							linelength /= ((double)factor/10.0);
+						}
+						break;
+					case INP_TOGGLEHELP:
+						help = !help;
+						break;
+					case INP_TOGGLESTATS:
+						showStats = !showStats;
+						statEnable(showStats);
+						break;
+					case INP_INCANGLE:
+						angle += 5.;
+						break;
+					case INP_DECANGLE:
+						angle -= 5.;
+						break;
+					case INP_INCLINELEN:
+						linelength += 3;
+						break;
+					case INP_DECLINELEN:
+						linelength -= 3;
+						break;
+					case INP_INCRANDANGLE:
+						randomizeAngle += 1.;
+						break;
+					case INP_RESETRANDANGLE:
+						randomizeAngle = 0.;
+						break;
+					case INP_DECYOFFSET:
+						view.offsetY -= (int)linelength;
+						break;
+					case INP_INCYOFFSET:
+						view.offsetY += (int)linelength;
+						break;
+					case INP_DECXOFFSET:
+						view.offsetX -= (int)linelength;
+						break;
+					case INP_INCXOFFSET:
+						view.offsetX += (int)linelength;
+						break;
+					case INP_RESETOFFSET:
+						resetView(&view);
+						break;
+					case INP_RESIZE:
+						/* keep the plant at the bottom center */
+						inputSize(&width, &height);
+						view.offsetX += (width - sgWidth()) / 2;
+						view.offsetY += height - sgHeight();
+						if (sgResize(width, height) != 0) {
+							exit(EXIT_FAILURE);
+						}
+						repaint = true;
+						break;
+					case INP_DRAG:
+						inputDrag(&dx, &dy);
+						view.offsetX += dx;
+						view.offsetY += dy;
+						break;
+					case INP_ZOOMIN:
+						inputMouse(&mouseX, &mouseY);
+						zoomView(&view, mouseX, mouseY, ZOOM_STEP);
+						break;
+					case INP_ZOOMOUT:
+						inputMouse(&mouseX, &mouseY);
+						zoomView(&view, mouseX, mouseY, 1.f / ZOOM_STEP);
+						break;
+					case INP_INSPECT:
+						/* only a complete plant can be inspected */
+						if (!complete) {
+							/* draw the plant the input aborted */
+							redraw = true;
+							input = INP_NULL;
+							break;
+						}
+						if (grid == NULL) {
+							grid = gridNew(geo);
+						}
+						inputMouse(&mouseX, &mouseY);
+						inspected = gridNearest(grid,
+							(mouseX - view.offsetX) / view.zoom,
+							(mouseY - view.offsetY) / view.zoom,
+							INSPECT_RADIUS / view.zoom);
+						break;
+					case INP_GROW:
+					case INP_REPLAY:
+						/* only a complete plant has all its segments */
+						if (!complete) {
+							/* draw the plant the input aborted */
+							redraw = true;
+							input = INP_NULL;
+							break;
+						}
+						animation = input == INP_GROW ? ANIM_DEPTH :
+							ANIM_DRAWING;
+						break;
+					case INP_EXPORT:
+						/* the export runs on a copy, so the plant can
+						 * change while it is being written */
+						if (!complete) {
+							sgClearScreen();
+							renderBegin(&job, lsys, (int)linelength, angle,
+								randomizeAngle, &view, geo);
+							renderStep(&job, job.length);
+							renderEnd(&job);
+							drawn = view;
+							complete = true;
+							/* show the whole plant */
+							redraw = true;
+						}
+						exportStart(geoCopy(geo), &exportOptions);
+						latencyInput(input, inputTime());
+						/* fall through */
+					case INP_EXPORTSTATUS:
+						/* only redraw the status line */
+						sgClearRect(0, SG_TEXTLINE(1), sgWidth(), 16);
+						drawExportStatus();
+						sgUpdateRect(0, SG_TEXTLINE(1), sgWidth(), 16);
+						latencyShown(input);
+						input = INP_NULL;
+						break;
+					default:
+						break;
+				}
+				if (input != INP_NULL) {
+					redraw = true;
+					latencyInput(input, inputTime());
+				}
+				if (input != INP_NULL && !isViewChange(input)) {
+					/* the geometry no longer matches the parameters */
+					complete = false;
+					inspected = -1;
+					if (grid != NULL) {
+						gridFree(grid);
+						grid = NULL;
+					}
+				}
+				input = pollInput();
+			}
+		} while (!redraw && running);
+	}
+	specCancel();
+	exportWait();
+	histClear();
+	if (grid != NULL) {
+		gridFree(grid);
+	}
+	geoFree(geo);
+	if (traceFile != NULL) {
+		traceWrite(traceFile);
+	}
+	if (latencyFile != NULL) {
+		latencyWrite(latencyFile);
 	}
+	inputScriptEnd();
+	perfClose();
 	SDL_Quit();
 
 	return 0;
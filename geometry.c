@@ -0,0 +1,83 @@
+/* geometry.c
+ * Growable buffer of turtle segments
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <string.h>
+#include "geometry.h"
+#include "tools.h"
+
+/**
+ * Creates a new, empty segment buffer
+ */
+Geometry *geoNew() {
+	Geometry *geo = new(Geometry);
+	memset(geo, 0, sizeof(Geometry));
+	return geo;
+}
+
+/**
+ * Removes all segments but keeps the allocated memory for reuse
+ */
+void geoClear(Geometry *geo) {
+	geo->count = 0;
+	geo->maxStackSize = 0;
+#ifdef VRML
+	geo->closes = 0;
+#endif
+}
+
+/**
+ * Appends a segment, doubling the buffer when it is full
+ */
+void geoAdd(Geometry *geo, Segment *seg) {
+	if (geo->count == geo->capacity) {
+		geo->capacity = geo->capacity == 0 ? 1024 : geo->capacity * 2;
+		geo->segs = (Segment*)memRealloc(geo->segs,
+			geo->capacity * sizeof(Segment));
+		if (geo->segs == NULL) {
+			fprintf(stderr, "realloc() failed");
+			exit(EXIT_FAILURE);
+		}
+	}
+	geo->segs[geo->count++] = *seg;
+}
+
+/**
+ * Returns a snapshot of the buffer that can be handed to another thread
+ */
+Geometry *geoCopy(Geometry *geo) {
+	Geometry *result = new(Geometry);
+	*result = *geo;
+	result->capacity = geo->count;
+	result->segs = NULL;
+	if (geo->count > 0) {
+		result->segs = newn(Segment, geo->count);
+		memcpy(result->segs, geo->segs, geo->count * sizeof(Segment));
+	}
+	return result;
+}
+
+/**
+ * Frees the buffer and all segments
+ */
+void geoFree(Geometry *geo) {
+	memFree(geo->segs);
+	memFree(geo);
+}
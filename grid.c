@@ -0,0 +1,286 @@
+/* grid.c
+ * Spatial index over the segments of a plant
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <string.h>
+#include "grid.h"
+#include "trace.h"
+#include "tools.h"
+
+#define minf(a,b) ((a) < (b) ? (a) : (b))
+#define maxf(a,b) ((a) > (b) ? (a) : (b))
+
+/**
+ * Computes the range of cells covered by a rectangle, clamped to the grid
+ */
+static void cellRange(Grid *grid, float x1, float y1, float x2, float y2,
+		int *c1, int *r1, int *c2, int *r2) {
+	*c1 = (int)((x1 - grid->x) / grid->cellSize);
+	*r1 = (int)((y1 - grid->y) / grid->cellSize);
+	*c2 = (int)((x2 - grid->x) / grid->cellSize);
+	*r2 = (int)((y2 - grid->y) / grid->cellSize);
+	*c1 = *c1 < 0 ? 0 : *c1;
+	*r1 = *r1 < 0 ? 0 : *r1;
+	*c2 = *c2 >= grid->cols ? grid->cols - 1 : *c2;
+	*r2 = *r2 >= grid->rows ? grid->rows - 1 : *r2;
+}
+
+/**
+ * Calls cellRange for the bounding box of a segment
+ */
+static void segmentRange(Grid *grid, Segment *seg, int *c1, int *r1,
+		int *c2, int *r2) {
+	cellRange(grid, minf(seg->x1, seg->x2), minf(seg->y1, seg->y2),
+		maxf(seg->x1, seg->x2), maxf(seg->y1, seg->y2), c1, r1, c2, r2);
+}
+
+/**
+ * Builds the index for all segments of the grid's geometry. Returns 1
+ * if it was canceled.
+ */
+static int buildIndex(Grid *grid) {
+	Geometry *geo = grid->geo;
+	Segment *seg;
+	float x2, y2, size;
+	int cells, entries, n;
+	int i, c, r, c1, r1, c2, r2;
+
+	/* bounding box of the plant */
+	if (geo->count > 0) {
+		grid->x = minf(geo->segs[0].x1, geo->segs[0].x2);
+		grid->y = minf(geo->segs[0].y1, geo->segs[0].y2);
+	}
+	x2 = grid->x;
+	y2 = grid->y;
+	size = GRID_MINCELL;
+	for (i = 0; i < geo->count; i++) {
+		seg = &geo->segs[i];
+		grid->x = minf(grid->x, minf(seg->x1, seg->x2));
+		grid->y = minf(grid->y, minf(seg->y1, seg->y2));
+		x2 = maxf(x2, maxf(seg->x1, seg->x2));
+		y2 = maxf(y2, maxf(seg->y1, seg->y2));
+		size = maxf(size, maxf(seg->x2 - seg->x1, seg->x1 - seg->x2));
+		size = maxf(size, maxf(seg->y2 - seg->y1, seg->y1 - seg->y2));
+	}
+	/* all segments have the same length, so cells of that size hold
+	 * few segments while every segment is in at most four cells */
+	grid->cellSize = maxf(size, maxf((x2 - grid->x) / GRID_MAXCELLS,
+		(y2 - grid->y) / GRID_MAXCELLS));
+	grid->cols = (int)((x2 - grid->x) / grid->cellSize) + 1;
+	grid->rows = (int)((y2 - grid->y) / grid->cellSize) + 1;
+	cells = grid->cols * grid->rows;
+	n = cells + 1;
+
+	/* count the entries of each cell, then sort the segments into
+	 * their cells */
+	grid->start = newn(int, n);
+	memset(grid->start, 0, n * sizeof(int));
+	for (i = 0; i < geo->count; i++) {
+		if (i % GRID_CHUNK == 0 && grid->cancel) {
+			return 1;
+		}
+		segmentRange(grid, &geo->segs[i], &c1, &r1, &c2, &r2);
+		for (r = r1; r <= r2; r++) {
+			for (c = c1; c <= c2; c++) {
+				grid->start[r * grid->cols + c + 1]++;
+			}
+		}
+	}
+	for (i = 0; i < cells; i++) {
+		grid->start[i + 1] += grid->start[i];
+	}
+	entries = grid->start[cells];
+	n = entries > 0 ? entries : 1;
+	grid->index = newn(int, n);
+	for (i = 0; i < geo->count; i++) {
+		if (i % GRID_CHUNK == 0 && grid->cancel) {
+			return 1;
+		}
+		segmentRange(grid, &geo->segs[i], &c1, &r1, &c2, &r2);
+		for (r = r1; r <= r2; r++) {
+			for (c = c1; c <= c2; c++) {
+				grid->index[grid->start[r * grid->cols + c]++] = i;
+			}
+		}
+	}
+	/* filling moved every start to the start of the next cell */
+	memmove(grid->start + 1, grid->start, cells * sizeof(int));
+	grid->start[0] = 0;
+
+	n = geo->count > 0 ? geo->count : 1;
+	grid->mark = newn(unsigned int, n);
+	memset(grid->mark, 0, n * sizeof(unsigned int));
+	grid->result = newn(int, n);
+	return 0;
+}
+
+/**
+ * Builds the index, see buildIndex()
+ */
+static int gridBuild(void *data) {
+	double span = traceBegin();
+	int canceled = buildIndex((Grid*)data);
+
+	traceEnd("grid build", span);
+	return canceled;
+}
+
+/**
+ * Thread function: builds the index in the background
+ */
+static int gridThread(void *data) {
+	traceThreadName("grid");
+	return gridBuild(data);
+}
+
+/**
+ * Creates an empty grid for geo
+ */
+static Grid *gridAlloc(Geometry *geo) {
+	Grid *grid;
+
+	grid = new(Grid);
+	memset(grid, 0, sizeof(Grid));
+	grid->geo = geo;
+	return grid;
+}
+
+/**
+ * Builds the index for all segments of geo. The geometry must not
+ * change while the grid is in use.
+ */
+Grid *gridNew(Geometry *geo) {
+	Grid *grid = gridAlloc(geo);
+
+	gridBuild(grid);
+	return grid;
+}
+
+/**
+ * Starts building the index for all segments of geo in the background.
+ * Queries wait until it is finished. The geometry must not change until
+ * the grid is freed.
+ */
+Grid *gridStart(Geometry *geo) {
+	Grid *grid = gridAlloc(geo);
+
+	grid->thread = SDL_CreateThread(gridThread, grid);
+	if (grid->thread == NULL) {
+		gridBuild(grid);
+	}
+	return grid;
+}
+
+/**
+ * Waits until the index is built
+ */
+void gridWait(Grid *grid) {
+	if (grid->thread != NULL) {
+		SDL_WaitThread(grid->thread, NULL);
+		grid->thread = NULL;
+	}
+}
+
+/**
+ * Finds the segments whose bounding box may touch the rectangle from
+ * x1, y1 to x2, y2. Returns their number; the segment numbers are in
+ * grid->result until the next query.
+ */
+int gridQuery(Grid *grid, float x1, float y1, float x2, float y2) {
+	int count = 0;
+	int i, c, r, c1, r1, c2, r2, cell;
+
+	gridWait(grid);
+	if (grid->geo->count == 0 || x2 < grid->x || y2 < grid->y ||
+			x1 > grid->x + grid->cols * grid->cellSize ||
+			y1 > grid->y + grid->rows * grid->cellSize) {
+		return 0;
+	}
+
+	/* a segment may be listed in several cells but is returned once */
+	grid->query++;
+	if (grid->query == 0) {
+		memset(grid->mark, 0, grid->geo->count * sizeof(unsigned int));
+		grid->query = 1;
+	}
+	cellRange(grid, x1, y1, x2, y2, &c1, &r1, &c2, &r2);
+	for (r = r1; r <= r2; r++) {
+		for (c = c1; c <= c2; c++) {
+			cell = r * grid->cols + c;
+			for (i = grid->start[cell]; i < grid->start[cell + 1]; i++) {
+				if (grid->mark[grid->index[i]] != grid->query) {
+					grid->mark[grid->index[i]] = grid->query;
+					grid->result[count++] = grid->index[i];
+				}
+			}
+		}
+	}
+	return count;
+}
+
+/**
+ * Returns the number of the segment closest to the point x, y, or -1 if
+ * there is none within maxDist. Of two equally close segments the one
+ * drawn later, i.e. the visible one, is returned.
+ */
+int gridNearest(Grid *grid, float x, float y, float maxDist) {
+	Segment *seg;
+	float best = maxDist * maxDist;
+	float dx, dy, px, py, t, dist;
+	int result = -1;
+	int count;
+	int i;
+
+	count = gridQuery(grid, x - maxDist, y - maxDist, x + maxDist,
+		y + maxDist);
+	for (i = 0; i < count; i++) {
+		seg = &grid->geo->segs[grid->result[i]];
+		/* project the point onto the segment */
+		dx = seg->x2 - seg->x1;
+		dy = seg->y2 - seg->y1;
+		t = 0.f;
+		if (dx != 0.f || dy != 0.f) {
+			t = ((x - seg->x1) * dx + (y - seg->y1) * dy) / (dx * dx + dy * dy);
+			t = minf(1.f, maxf(0.f, t));
+		}
+		px = seg->x1 + t * dx - x;
+		py = seg->y1 + t * dy - y;
+		dist = px * px + py * py;
+		if (dist < best || (dist == best && grid->result[i] > result)) {
+			best = dist;
+			result = grid->result[i];
+		}
+	}
+	return result;
+}
+
+/**
+ * Frees the index, but not the geometry. A build that is still running
+ * is canceled.
+ */
+void gridFree(Grid *grid) {
+	grid->cancel = true;
+	gridWait(grid);
+	memFree(grid->start);
+	memFree(grid->index);
+	memFree(grid->mark);
+	memFree(grid->result);
+	memFree(grid);
+}
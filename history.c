@@ -0,0 +1,217 @@
+/* history.c
+ * Cache of recently derived iterations
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <string.h>
+#include "history.h"
+#include "lsystem.h"
+#include "tools.h"
+
+/*
+ * The history owns the derived strings. When the cached strings exceed
+ * the memory budget, the least recently used ones are freed. The first
+ * iteration (the axiom) is always kept, so every iteration can be
+ * derived again from the closest cached one.
+ */
+
+typedef struct {
+	int iteration;		/* 0 for unused entries */
+	char *lsys;
+	unsigned long bytes;
+	unsigned long lastUse;
+} HistEntry;
+
+static HistEntry entries[HIST_MAX];
+static unsigned long budget = HIST_BUDGET;
+static unsigned long used;
+/** Counter to order the entries by their last use */
+static unsigned long useCount;
+
+/**
+ * Sets the memory budget for the cached strings in bytes
+ */
+void histSetBudget(unsigned long bytes) {
+	budget = bytes;
+}
+
+/**
+ * Returns the entry for an iteration, or NULL if it is not cached
+ */
+static HistEntry *find(int iteration) {
+	int i;
+
+	for (i = 0; i < HIST_MAX; i++) {
+		if (entries[i].iteration == iteration) {
+			return &entries[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Frees the string of an entry
+ */
+static void evict(HistEntry *e) {
+	used -= e->bytes;
+	memFree(e->lsys);
+	e->iteration = 0;
+	e->lsys = NULL;
+	e->bytes = 0;
+}
+
+/**
+ * Returns an unused entry, or NULL if all of them are used
+ */
+static HistEntry *unused() {
+	int i;
+
+	for (i = 0; i < HIST_MAX; i++) {
+		if (entries[i].iteration == 0) {
+			return &entries[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Returns the least recently used entry that may be evicted, or NULL if
+ * there is none. Unused entries, keep and the first iteration are never
+ * chosen.
+ */
+static HistEntry *leastRecentlyUsed(HistEntry *keep) {
+	HistEntry *result = NULL;
+	int i;
+
+	for (i = 0; i < HIST_MAX; i++) {
+		if (entries[i].iteration == 0 || &entries[i] == keep ||
+				entries[i].iteration == 1) {
+			continue;
+		}
+		if (result == NULL || entries[i].lastUse < result->lastUse) {
+			result = &entries[i];
+		}
+	}
+	return result;
+}
+
+/**
+ * Adds an iteration to the history, which takes ownership of lsys.
+ * If lsys is already cached for another iteration (the L-System did
+ * not change), a copy is stored. Returns the stored string.
+ */
+char *histAdd(int iteration, char *lsys) {
+	HistEntry *e = find(iteration);
+	HistEntry *victim;
+	int i;
+
+	for (i = 0; i < HIST_MAX; i++) {
+		if (entries[i].iteration != 0 && entries[i].lsys == lsys
+				&& &entries[i] != e) {
+			char *copy = newn(char, strlen(lsys) + 1);
+			strcpy(copy, lsys);
+			lsys = copy;
+			break;
+		}
+	}
+	if (e != NULL) {
+		if (e->lsys == lsys) {
+			e->lastUse = ++useCount;
+			return lsys;
+		}
+		evict(e);
+	} else {
+		e = unused();
+		if (e == NULL) {
+			e = leastRecentlyUsed(NULL);
+			evict(e);
+		}
+	}
+	e->iteration = iteration;
+	e->lsys = lsys;
+	e->bytes = strlen(lsys) + 1;
+	e->lastUse = ++useCount;
+	used += e->bytes;
+
+	/* make room, but always keep the new entry */
+	while (used > budget) {
+		victim = leastRecentlyUsed(e);
+		if (victim == NULL) {
+			break;
+		}
+		evict(victim);
+	}
+	return lsys;
+}
+
+/**
+ * Returns the bytes of the cached strings
+ */
+unsigned long histUsed() {
+	return used;
+}
+
+/**
+ * Returns a cached iteration, or NULL if it is not cached
+ */
+char *histGet(int iteration) {
+	HistEntry *e = find(iteration);
+
+	if (e == NULL) {
+		return NULL;
+	}
+	e->lastUse = ++useCount;
+	return e->lsys;
+}
+
+/**
+ * Returns an iteration from the history. If it was evicted, it is
+ * derived again from the closest cached iteration before it.
+ */
+char *histFetch(int iteration, char *fTo) {
+	char *lsys = histGet(iteration);
+	int i;
+
+	if (lsys != NULL) {
+		return lsys;
+	}
+	for (i = iteration - 1; i >= 1 && lsys == NULL; i--) {
+		lsys = histGet(i);
+	}
+	if (lsys == NULL) {
+		return NULL;
+	}
+	for (i += 2; i <= iteration; i++) {
+		lsys = histAdd(i, lSystem(lsys, fTo));
+	}
+	return lsys;
+}
+
+/**
+ * Frees all cached iterations
+ */
+void histClear() {
+	int i;
+
+	for (i = 0; i < HIST_MAX; i++) {
+		if (entries[i].iteration != 0) {
+			evict(&entries[i]);
+		}
+	}
+}
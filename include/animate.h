@@ -0,0 +1,56 @@
+/* animate.h
+ * Include file for the growth animation
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _ANIMATE_H_
+#define _ANIMATE_H_
+
+#include <stdbool.h>
+#include "SDL.h"
+#include "geometry.h"
+#include "renderlsystem.h"
+
+/* Frames per second of the animation */
+#define ANIM_FPS 30
+/* Duration of the whole animation in milliseconds */
+#define ANIM_DURATION 5000
+
+enum animOrders {ANIM_DRAWING = 0, ANIM_DEPTH};
+
+/**
+ * A plant growing on the screen. The segments are revealed in a fixed
+ * order, and every frame only draws the ones that were not drawn yet.
+ */
+typedef struct {
+	Geometry *geo;
+	View view;
+	int *order;			/* segment numbers in the order they appear */
+	int shown;			/* number of segments drawn so far */
+	Uint32 start;		/* time of the first frame */
+} Animation;
+
+void animStart(Animation *anim, Geometry *geo, char *lsys, View *view,
+		int order);
+bool animFrame(Animation *anim);
+bool animFrameAt(Animation *anim, Uint32 elapsed);
+void animWait(Animation *anim);
+void animEnd(Animation *anim);
+
+#endif
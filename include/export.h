@@ -0,0 +1,58 @@
+/* export.h
+ * Include file for the background exporter
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _EXPORT_H_
+#define _EXPORT_H_
+
+#include <stdbool.h>
+#include "geometry.h"
+#include "writer.h"
+
+/* code of the SDL_USEREVENT sent when the export progress changed */
+#define EXPORT_EVENT 1
+
+/* Export file formats, chosen by the file name extension */
+enum exportFormats {EXP_VRML = 0, EXP_PLY, EXP_GLB, EXP_SVG};
+
+typedef struct {
+	char *filename;
+	double tubeWidth;	/* PLY/glTF: extrude branches to tubes of this
+						 * width, 0 exports them as lines */
+	double tolerance;	/* SVG: simplify paths by up to this many pixels */
+} ExportOptions;
+
+typedef struct {
+	bool active;		/* an export is running */
+	bool failed;		/* the last export could not be written */
+	char *filename;
+	double progress;	/* fraction of segments written, 0..1 */
+	double throughput;	/* bytes per second */
+	unsigned long bytes;
+} ExportStatus;
+
+bool exportCompressed(char *filename);
+int exportFormat(char *filename);
+bool exportStart(Geometry *geo, ExportOptions *options);
+void exportProgress(Writer *w, int done, int total);
+void exportGetStatus(ExportStatus *status);
+void exportWait();
+
+#endif
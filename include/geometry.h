@@ -0,0 +1,61 @@
+/* geometry.h
+ * Include file for the segment buffer produced by the renderer
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _GEOMETRY_H_
+#define _GEOMETRY_H_
+
+/**
+ * A single line segment drawn by the turtle. Coordinates are relative
+ * to the starting point of the turtle, i.e. without screen offset.
+ */
+typedef struct {
+	float x1;
+	float y1;
+	float x2;
+	float y2;
+	int symbol;		/* position of the F in the L-System that drew it */
+#ifdef VRML
+	int rotation;	/* direction of the last turn before this segment */
+	int closes;		/* number of transforms to close before this segment */
+#endif
+} Segment;
+
+/**
+ * All segments of one interpretation of an L-System
+ */
+typedef struct {
+	Segment *segs;
+	int count;
+	int capacity;
+	int maxStackSize;
+	double angle;	/* turning angle in radians */
+#ifdef VRML
+	int closes;		/* transforms closed after the last segment */
+#endif
+} Geometry;
+
+Geometry *geoNew();
+void geoClear(Geometry *geo);
+void geoAdd(Geometry *geo, Segment *seg);
+Geometry *geoCopy(Geometry *geo);
+void geoFree(Geometry *geo);
+
+#endif
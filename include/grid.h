@@ -0,0 +1,64 @@
+/* grid.h
+ * Include file for the spatial index over segments
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _GRID_H_
+#define _GRID_H_
+
+#include <stdbool.h>
+#include "SDL.h"
+#include "geometry.h"
+
+/* The grid has at most this many cells in each direction */
+#define GRID_MAXCELLS 256
+/* Cells are at least as large as the longest segment, and this large */
+#define GRID_MINCELL 1.f
+/* Number of segments between two checks for cancellation */
+#define GRID_CHUNK 65536
+
+/**
+ * Uniform grid over the segments of a Geometry. Every cell lists the
+ * segments whose bounding box touches it, so the segments in an area
+ * can be found without looking at the whole plant.
+ */
+typedef struct {
+	Geometry *geo;
+	float x;			/* top left corner of the first cell */
+	float y;
+	float cellSize;
+	int cols;
+	int rows;
+	int *start;			/* first entry of each cell in index */
+	int *index;			/* segment numbers, sorted by cell */
+	unsigned int *mark;	/* last query that returned a segment */
+	unsigned int query;
+	int *result;		/* segment numbers found by the last query */
+	SDL_Thread *thread;	/* builds the grid, NULL when it is ready */
+	volatile bool cancel;
+} Grid;
+
+Grid *gridNew(Geometry *geo);
+Grid *gridStart(Geometry *geo);
+void gridWait(Grid *grid);
+int gridQuery(Grid *grid, float x1, float y1, float x2, float y2);
+int gridNearest(Grid *grid, float x, float y, float maxDist);
+void gridFree(Grid *grid);
+
+#endif
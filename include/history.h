@@ -0,0 +1,37 @@
+/* history.h
+ * Include file for the iteration history
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _HISTORY_H_
+#define _HISTORY_H_
+
+/* Default memory budget for the cached iterations */
+#define HIST_BUDGET (512ul << 20)
+/* Maximum number of cached iterations */
+#define HIST_MAX 64
+
+void histSetBudget(unsigned long bytes);
+char *histAdd(int iteration, char *lsys);
+unsigned long histUsed();
+char *histGet(int iteration);
+char *histFetch(int iteration, char *fTo);
+void histClear();
+
+#endif
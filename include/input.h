@@ -25,11 +25,22 @@
 #include <stdbool.h>
 #include "SDL.h"
 
-enum inputResults {INP_NULL = 0, INP_QUIT, INP_CONT, INP_TOGGLEHELP,
-	INP_INCLINELEN, INP_DECLINELEN, INP_INCANGLE, INP_DECANGLE,
+enum inputResults {INP_NULL = 0, INP_QUIT, INP_CONT, INP_BACK,
+	INP_TOGGLEHELP, INP_INCLINELEN, INP_DECLINELEN, INP_INCANGLE, INP_DECANGLE,
 	INP_INCRANDANGLE, INP_RESETRANDANGLE, INP_INCXOFFSET, INP_DECXOFFSET,
-	INP_INCYOFFSET, INP_DECYOFFSET, INP_RESETOFFSET, INP_EXPORTVRML};
+	INP_INCYOFFSET, INP_DECYOFFSET, INP_RESETOFFSET, INP_EXPORT,
+	INP_EXPORTSTATUS, INP_ZOOMIN, INP_ZOOMOUT, INP_DRAG,
+	INP_INSPECT, INP_RESIZE, INP_GROW, INP_REPLAY,
+	INP_TOGGLESTATS};
 
+bool inputScript(char *filename);
+void inputScriptEnd();
 int checkInput();
+int pollInput();
+bool inputPending();
+double inputTime();
+void inputMouse(int *x, int *y);
+void inputDrag(int *dx, int *dy);
+void inputSize(int *width, int *height);
 
 #endif
@@ -0,0 +1,37 @@
+/* latency.h
+ * Time from input to the frame that shows it
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include <stdbool.h>
+
+/* Kinds of input that are measured separately */
+enum latencyKinds {LAT_PAN = 0, LAT_ZOOM, LAT_ANGLE, LAT_LENGTH,
+	LAT_ITERATION, LAT_EXPORT, LAT_KINDS};
+
+void latencyEnable();
+void latencyInput(int input, double dequeued);
+void latencyPresented();
+void latencyShown(int input);
+bool latencyWrite(char *filename);
+
+#endif
@@ -21,8 +21,13 @@
 
 #ifndef _LSYSTEM_H
 #define _LSYSTEM_H
+#include <stdbool.h>
+#include <stddef.h>
 #include "list.h"
 
+/* Derived strings at least this long are backed by huge pages */
+#define LSYS_HUGEPAGE (2ul << 20)
+
 typedef struct {
 	double x;
 	double y;
@@ -36,7 +41,9 @@ typedef struct {
 Object stateToObject(State n);
 Object newState(double x, double y, double ang);
 void printList(List xs);
+size_t lSysLength(char *lsys, char *fTo);
 char *lSystem(char *lsys, char *fTo);
+char *lSysDerive(char *lsys, char *fTo, volatile bool *cancel);
 char *lSysIterate(char *start, char *fTo, int iterations);
 
 #endif
@@ -0,0 +1,44 @@
+/* mem.h
+ * Counted allocations
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _MEM_H_
+#define _MEM_H_
+
+#include <stddef.h>
+
+/**
+ * Allocations made through memAlloc() and memRealloc() since the start
+ */
+typedef struct {
+	unsigned long calls;	/* allocations and reallocations */
+	unsigned long bytes;	/* bytes requested by them */
+	unsigned long live;		/* bytes allocated and not freed yet */
+	unsigned long peak;		/* most bytes live since memResetPeak() */
+} MemStats;
+
+void *memAlloc(size_t size);
+void *memAllocOrDie(size_t size);
+void *memRealloc(void *p, size_t size);
+void memFree(void *p);
+void memGetStats(MemStats *stats);
+void memResetPeak();
+
+#endif
@@ -0,0 +1,36 @@
+/* meshexport.h
+ * Include file for the binary mesh exporters
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _MESHEXPORT_H_
+#define _MESHEXPORT_H_
+
+#include "geometry.h"
+#include "writer.h"
+
+/* Number of sides of the tubes branches are extruded to */
+#define TUBE_SIDES 6
+/* Number of segments converted per block written */
+#define MESH_CHUNK 16384
+
+void writePLY(Writer *w, Geometry *geo, double tubeWidth);
+void writeGLB(Writer *w, Geometry *geo, double tubeWidth);
+
+#endif
@@ -0,0 +1,36 @@
+/* patterns.h
+ * Plant patterns listed in the README
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _PATTERNS_H_
+#define _PATTERNS_H_
+
+/**
+ * A pattern from the README with the options it is shown with
+ */
+typedef struct {
+	char rule[100];
+	double angle;
+	int factor;
+} Pattern;
+
+int readPatterns(char *filename, Pattern *patterns, int max);
+
+#endif
@@ -0,0 +1,51 @@
+/* perf.h
+ * Include file for the hardware performance counters
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _PERF_H_
+#define _PERF_H_
+
+#include <stdbool.h>
+
+/* Events counted by the processor */
+enum perfEvents {PERF_CYCLES = 0, PERF_INSTRUCTIONS, PERF_CACHEMISSES,
+	PERF_BRANCHMISSES, PERF_EVENTS};
+
+/**
+ * Counter values, or the difference between two readings. Events the
+ * processor cannot count are negative. While other programs use the
+ * counters too, they only count part of the time; differences are
+ * scaled up to the whole time by perfSub().
+ */
+typedef struct {
+	bool valid;
+	double values[PERF_EVENTS];
+	double enabled;		/* nanoseconds the counters were enabled */
+	double running;		/* and actually counting */
+} PerfCounts;
+
+bool perfOpen();
+bool perfOwned();
+bool perfRead(PerfCounts *counts);
+void perfSub(PerfCounts *to, PerfCounts *from);
+void perfAdd(PerfCounts *sum, PerfCounts *counts);
+void perfClose();
+
+#endif
@@ -22,16 +22,62 @@
 #ifndef _RENDERLSYSTEM_H_
 #define _RENDERLSYSTEM_H_
 
-#ifdef VRML
 #include <stdbool.h>
+#include <stddef.h>
+#include "SDL.h"
+#include "geometry.h"
+#include "grid.h"
+#include "lsystem.h"
 
-void renderLSystem(char *lsys, int len, double angle, double randomize,
-		int offsetX, int offsetY, bool exportVRML);
-#else
+/* Number of symbols interpreted between two checks for user input */
+#define RENDER_CHUNK 65536
+/* Initial depth of the turtle's stack */
+#define RENDER_STACK 64
 
-void renderLSystem(char *lsys, int len, double angle, double randomize,
-		int offsetX, int offsetY);
+/**
+ * Maps turtle coordinates to the screen: a point is drawn at
+ * (int)(x * zoom) + offsetX, (int)(y * zoom) + offsetY
+ */
+typedef struct {
+	float zoom;
+	int offsetX;		/* screen position of the turtle's starting point */
+	int offsetY;
+} View;
+
+/**
+ * State of an interpretation that can be run in chunks
+ */
+typedef struct {
+	char *lsys;
+	size_t pos;			/* next symbol to interpret */
+	size_t length;
+	int len;
+	double angle;
+	double randomize;
+	View view;
+	State state;		/* the turtle */
+	State *stack;		/* pushed states, grown by doubling */
+	int depth;
+	int stackCapacity;
+	int maxStackSize;
+#ifdef VRML
+	int closes;			/* transforms closed since the last segment */
 #endif
+	Geometry *geo;
+} RenderJob;
+
+void renderBegin(RenderJob *job, char *lsys, int len, double angle,
+		double randomize, View *view, Geometry *geo);
+bool renderStep(RenderJob *job, size_t count);
+void renderEnd(RenderJob *job);
+void renderStatus(RenderJob *job);
+void renderLSystem(char *lsys, int len, double angle, double randomize,
+		View *view, Geometry *geo);
+void renderView(Geometry *geo, View *view);
+void renderRegion(Grid *grid, View *view, SDL_Rect *rect);
+void renderHighlight(Segment *seg, View *view, Uint32 color);
+void renderUnhighlight(Grid *grid, View *view, Segment *seg);
+void renderPan(Grid *grid, View *from, View *to);
 
 #endif
 
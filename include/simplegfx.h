@@ -29,19 +29,37 @@
 #include "tools.h"
 #include "SDL.h"
 
-/* To keep it simple, we use a static resolution */
-#define XRES 800
-#define YRES 600
+/* Default resolution, can be changed with sgResize() */
+#define DEFAULT_XRES 800
+#define DEFAULT_YRES 600
 
-int sgInit(bool fullscreen, char *title);
+/* Y position of the n-th line of text from the bottom of the screen */
+#define SG_TEXTLINE(n) (sgHeight() - 20 - (n) * 18)
+
+/* Number of texts whose position is remembered for scrolling */
+#define SG_MAXTEXTS 16
+/* Maximum number of areas sgScroll() asks to redraw */
+#define SG_MAXDAMAGE (2 + 2 * SG_MAXTEXTS)
+
+int sgInit(bool fullscreen, char *title, int width, int height);
+int sgInitHeadless(char *title, int width, int height);
+int sgResize(int width, int height);
+int sgSetDepth(int bpp);
+int sgWidth();
+int sgHeight();
 SDL_Surface *sgCreateSurface(int width, int height);
 Uint32 sgCreateColor(Uint8 r, Uint8 g, Uint8 b);
 void sgPutPixel(SDL_Surface *surface, int x, int y, Uint32 color);
+Uint32 sgGetPixel(SDL_Surface *surface, int x, int y);
 void sgDrawImage(SDL_Surface *img, int x, int y);
 void sgUpdateScreen();
 void sgClearScreen();
+void sgClearRect(int x, int y, int w, int h);
+void sgUpdateRect(int x, int y, int w, int h);
 void sgDrawText(char *text, int x, int y, Uint32 color);
 void sgLine(int x1, int y1, int x2, int y2, Uint32 color);
+void sgSetClip(SDL_Rect *rect);
+int sgScroll(int dx, int dy, SDL_Rect *damage);
 
 #endif
 
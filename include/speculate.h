@@ -0,0 +1,33 @@
+/* speculate.h
+ * Include file for the speculative derivation of the next iteration
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _SPECULATE_H_
+#define _SPECULATE_H_
+
+/* Default memory budget for a speculatively derived iteration */
+#define SPEC_BUDGET (256ul << 20)
+
+void specSetBudget(unsigned long bytes);
+void specStart(char *lsys, char *fTo);
+char *specTake(char *lsys, char *fTo);
+void specCancel();
+
+#endif
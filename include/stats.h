@@ -0,0 +1,67 @@
+/* stats.h
+ * Include file for the timing of the drawing stages
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdbool.h>
+#include "perf.h"
+
+/* Only one of this many lines is timed, reading the clock for each of
+ * them would take longer than drawing them */
+#define STAT_SAMPLE 64
+
+/* Stages with hardware counters: deriving, interpreting including the
+ * lines drawn by the turtle, and redrawing recorded segments */
+enum statStages {STAT_DERIVE = 0, STAT_RENDER, STAT_RASTER, STAT_STAGES};
+
+/**
+ * Time spent in each stage of drawing a frame, in seconds, and the
+ * amount of work done in it. The derivation is the last one that
+ * finished, no matter on which thread.
+ */
+typedef struct {
+	double derive;
+	unsigned long symbols;		/* symbols produced by the derivation */
+	double interpret;			/* moving the turtle, without drawing */
+	unsigned long segments;
+	double raster;
+	unsigned long pixels;		/* pixels written by the line drawing */
+	double text;
+	unsigned long allocs;		/* allocations on all threads */
+	PerfCounts counts[STAT_STAGES];	/* only with perfOpen() */
+} Stats;
+
+void statInit();
+void statEnable(bool enable);
+bool statEnabled();
+double statNow();
+void statReset();
+void statDerived(double seconds, unsigned long symbols);
+void statInterpreted(double seconds, unsigned long segments);
+void statRasterized(double seconds, unsigned long pixels);
+void statTextDrawn(double seconds);
+bool statCountBegin(PerfCounts *before);
+void statCountEnd(int stage, PerfCounts *before);
+void statGet(Stats *stats);
+unsigned long statRSS();
+
+#endif
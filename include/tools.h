@@ -24,19 +24,16 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include "mem.h"
 
 /**
- * Macros to allocate memory and auto-panic on failure.
+ * Macros to allocate memory and auto-panic on failure. The memory is
+ * counted and has to be freed with memFree().
  */
-static void __attribute__((__unused__)) *_new_ptr = NULL;
 /* new(): allocate memory and return as pointer */
-#define new(x) (x *)(_new_ptr = malloc(sizeof(x))); \
-	if (NULL==_new_ptr) { fprintf(stderr, "malloc() failed"); \
-	exit(EXIT_FAILURE); }
+#define new(x) (x *)memAllocOrDie(sizeof(x))
 /* newn(): allocate n units of memory and return as pointer */
-#define newn(x,n) (x *)(_new_ptr = malloc(sizeof(x)*n)); \
-	if (NULL==_new_ptr) { fprintf(stderr, "malloc() failed"); \
-	exit(EXIT_FAILURE); }
+#define newn(x,n) (x *)memAllocOrDie(sizeof(x)*(n))
 
 double normalizeAngle(double ang);
 double deg2rad(double ang);
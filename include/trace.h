@@ -0,0 +1,39 @@
+/* trace.h
+ * Include file for the Chrome trace export
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdbool.h>
+
+/* Maximum number of threads with their own event buffer */
+#define TRACE_MAXTHREADS 64
+/* Number of events allocated at once for a thread */
+#define TRACE_BLOCK 4096
+
+void traceStart();
+bool traceEnabled();
+void traceThreadName(const char *name);
+double traceBegin();
+void traceEnd(const char *name, double start);
+bool traceWrite(char *filename);
+
+#endif
@@ -0,0 +1,55 @@
+/* video.h
+ * Include file for the raw video output
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _VIDEO_H_
+#define _VIDEO_H_
+
+#include <stdbool.h>
+#include "SDL.h"
+
+/* Number of frame buffers between the renderer and the writer thread */
+#define VIDEO_RING 2
+
+/**
+ * A YUV4MPEG2 stream. Frames are converted to YUV 4:2:0 by the caller
+ * and written to the file by a separate thread.
+ */
+typedef struct {
+	int fd;
+	int width;
+	int height;
+	size_t frameSize;		/* bytes of one frame including its header */
+	char *bufs[VIDEO_RING];
+	int head;				/* oldest queued frame */
+	int count;				/* frames queued or being written */
+	bool done;				/* no more frames will be queued */
+	bool failed;
+	unsigned long frames;	/* frames handed to the writer */
+	SDL_mutex *lock;
+	SDL_cond *cond;
+	SDL_Thread *thread;
+} Video;
+
+Video *videoOpen(char *filename, int width, int height, int fps);
+void videoFrame(Video *video, SDL_Surface *surface);
+bool videoClose(Video *video);
+
+#endif
@@ -0,0 +1,55 @@
+/* writer.h
+ * Include file for the buffered file writer used by the exporters
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _WRITER_H_
+#define _WRITER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+/* Size of the output buffer; data is handed to the kernel in blocks
+ * of this size */
+#define WR_BUFSIZE (1 << 20)
+/* Blocks written by one writev() call in wrWritev() */
+#define WR_MAXIOV 15
+/* Highest precision handled by the fast path of wrDouble() */
+#define WR_MAXPREC 9
+
+typedef struct {
+	int fd;
+	char *buf;
+	size_t len;				/* bytes currently in the buffer */
+	unsigned long written;	/* total bytes handed to the writer */
+	bool failed;
+	struct Ring *ring;		/* compression thread, NULL for plain files */
+} Writer;
+
+Writer *wrOpen(char *filename, bool compress);
+void wrWrite(Writer *w, const char *data, size_t n);
+void wrWritev(Writer *w, struct iovec *iov, int count);
+void wrPuts(Writer *w, const char *s);
+void wrInt(Writer *w, long x);
+void wrDouble(Writer *w, double d, int prec);
+void wrFlush(Writer *w);
+bool wrClose(Writer *w);
+
+#endif
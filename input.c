@@ -19,67 +19,417 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
  */
 
+#include <string.h>
 #include "input.h"
+#include "export.h"
+#include "stats.h"
+#include "trace.h"
+#include "tools.h"
+
+/* Queued events inputPending() looks at */
+#define INPUT_PEEK 16
+/* Longest line of an input script */
+#define SCRIPT_LINE 100
+
+/**
+ * One action of an input script, as the event it stands for, and how long
+ * it took until genplant waited for input again
+ */
+typedef struct {
+	SDL_Event event;
+	char action[SCRIPT_LINE];
+	int line;
+	double seconds;
+} ScriptStep;
+
+/** Position of the mouse at the last mouse event */
+static int mouseX = 0;
+static int mouseY = 0;
+/** Movement of the mouse at the last drag event */
+static int dragX = 0;
+static int dragY = 0;
+/** Size of the window after the last resize event */
+static int resizeWidth = 0;
+static int resizeHeight = 0;
+/** When the event of the last input was taken from the queue */
+static double dequeued = 0.;
+/** Input script replacing the event queue, NULL for the user's input */
+static ScriptStep *script = NULL;
+static int scriptSteps = 0;
+static int scriptNext = 0;
+/** Time from loading the script until the first frame was shown */
+static double scriptFirst = 0.;
+
+/**
+ * Translates an SDL event into one of the inputResults, INP_NULL if the
+ * event is of no interest
+ */
+static int translateEvent(SDL_Event *event) {
+	/* closed window */
+	if (event->type == SDL_QUIT) {
+		return INP_QUIT;
+	}
+
+	/* resized window */
+	if (event->type == SDL_VIDEORESIZE) {
+		resizeWidth = event->resize.w;
+		resizeHeight = event->resize.h;
+		return INP_RESIZE;
+	}
+
+	/* progress of a background export */
+	if (event->type == SDL_USEREVENT && event->user.code == EXPORT_EVENT) {
+		return INP_EXPORTSTATUS;
+	}
+
+	/* mouse wheel and right click */
+	if (event->type == SDL_MOUSEBUTTONDOWN) {
+		mouseX = event->button.x;
+		mouseY = event->button.y;
+		if (event->button.button == SDL_BUTTON_WHEELUP) {
+			return INP_ZOOMIN;
+		}
+		if (event->button.button == SDL_BUTTON_WHEELDOWN) {
+			return INP_ZOOMOUT;
+		}
+		if (event->button.button == SDL_BUTTON_RIGHT) {
+			return INP_INSPECT;
+		}
+	}
+
+	/* mouse movement with the left button held down */
+	if (event->type == SDL_MOUSEMOTION &&
+			(event->motion.state & SDL_BUTTON(SDL_BUTTON_LEFT))) {
+		mouseX = event->motion.x;
+		mouseY = event->motion.y;
+		dragX = event->motion.xrel;
+		dragY = event->motion.yrel;
+		return INP_DRAG;
+	}
+
+	/* key press */
+	if (event->type == SDL_KEYDOWN) {
+		switch(event->key.keysym.sym) {
+			case SDLK_SPACE:
+				return INP_CONT;
+				break;
+			case SDLK_BACKSPACE:
+				return INP_BACK;
+			case SDLK_ESCAPE:
+				return INP_QUIT;
+			case SDLK_h:
+				return INP_TOGGLEHELP;
+			case SDLK_a:
+				return INP_INCANGLE;
+			case SDLK_s:
+				return INP_DECANGLE;
+			case SDLK_q:
+				return INP_INCLINELEN;
+			case SDLK_w:
+				return INP_DECLINELEN;
+			case SDLK_r:
+				return INP_INCRANDANGLE;
+			case SDLK_t:
+				return INP_RESETRANDANGLE;
+			case SDLK_UP:
+				return INP_DECYOFFSET;
+			case SDLK_DOWN:
+				return INP_INCYOFFSET;
+			case SDLK_LEFT:
+				return INP_DECXOFFSET;
+			case SDLK_RIGHT:
+				return INP_INCXOFFSET;
+			case SDLK_o:
+				return INP_RESETOFFSET;
+			case SDLK_m:
+				return INP_EXPORT;
+			case SDLK_g:
+				return INP_GROW;
+			case SDLK_d:
+				return INP_REPLAY;
+			case SDLK_i:
+				return INP_TOGGLESTATS;
+			default: break;
+		}
+	}
+
+	return INP_NULL;
+}
+
+/**
+ * Turns one line of an input script into an event. Returns false if the
+ * action is unknown or its arguments are missing.
+ */
+static bool parseAction(char *line, SDL_Event *event) {
+	static const struct {
+		char *name;
+		SDLKey key;
+	} keys[] = {{"space", SDLK_SPACE}, {"backspace", SDLK_BACKSPACE},
+		{"escape", SDLK_ESCAPE}, {"up", SDLK_UP}, {"down", SDLK_DOWN},
+		{"left", SDLK_LEFT}, {"right", SDLK_RIGHT}};
+	char action[SCRIPT_LINE];
+	int x;
+	int y;
+	int args;
+	int i;
+
+	memset(event, 0, sizeof(SDL_Event));
+	args = sscanf(line, "%99s %d %d", action, &x, &y);
+	if (strcmp(action, "quit") == 0) {
+		event->type = SDL_QUIT;
+		return true;
+	}
+	if (strlen(action) == 1 && action[0] >= 'a' && action[0] <= 'z') {
+		event->type = SDL_KEYDOWN;
+		event->key.keysym.sym = (SDLKey)(SDLK_a + action[0] - 'a');
+		return true;
+	}
+	for (i = 0; i < (int)(sizeof(keys) / sizeof(keys[0])); i++) {
+		if (strcmp(action, keys[i].name) == 0) {
+			event->type = SDL_KEYDOWN;
+			event->key.keysym.sym = keys[i].key;
+			return true;
+		}
+	}
+
+	/* the mouse and the window need a position or size */
+	if (args != 3) {
+		return false;
+	}
+	if (strcmp(action, "zoomin") == 0 || strcmp(action, "zoomout") == 0 ||
+			strcmp(action, "inspect") == 0) {
+		event->type = SDL_MOUSEBUTTONDOWN;
+		event->button.x = (Uint16)x;
+		event->button.y = (Uint16)y;
+		event->button.button = strcmp(action, "zoomin") == 0 ?
+			SDL_BUTTON_WHEELUP : strcmp(action, "zoomout") == 0 ?
+			SDL_BUTTON_WHEELDOWN : SDL_BUTTON_RIGHT;
+		return true;
+	}
+	if (strcmp(action, "drag") == 0) {
+		event->type = SDL_MOUSEMOTION;
+		event->motion.state = SDL_BUTTON(SDL_BUTTON_LEFT);
+		event->motion.xrel = (Sint16)x;
+		event->motion.yrel = (Sint16)y;
+		return true;
+	}
+	if (strcmp(action, "resize") == 0 && x > 0 && y > 0) {
+		event->type = SDL_VIDEORESIZE;
+		event->resize.w = x;
+		event->resize.h = y;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Reads an input script, which replaces the event queue from now on.
+ * Every line is one action: a key (space, backspace, escape, up, down,
+ * left, right or a letter), zoomin/zoomout/inspect x y, drag dx dy,
+ * resize width height or quit. Empty lines and lines starting with # are
+ * skipped. Returns false if the file could not be read or has errors.
+ */
+bool inputScript(char *filename) {
+	FILE *f;
+	char line[SCRIPT_LINE];
+	char *start;
+	int lines = 0;
+	int count = 0;
+
+	f = fopen(filename, "r");
+	if (f == NULL) {
+		perror(filename);
+		return false;
+	}
+	while (fgets(line, SCRIPT_LINE, f) != NULL) {
+		lines++;
+	}
+	rewind(f);
+	script = newn(ScriptStep, lines + 1);
+	lines = 0;
+	while (fgets(line, SCRIPT_LINE, f) != NULL) {
+		lines++;
+		line[strcspn(line, "\r\n")] = '\0';
+		start = line + strspn(line, " \t");
+		if (*start == '\0' || *start == '#') {
+			continue;
+		}
+		if (!parseAction(start, &script[count].event)) {
+			fprintf(stderr, "%s:%d: Invalid action: %s\n", filename, lines,
+				start);
+			fclose(f);
+			memFree(script);
+			script = NULL;
+			return false;
+		}
+		strcpy(script[count].action, start);
+		script[count].line = lines;
+		script[count].seconds = 0.;
+		count++;
+	}
+	fclose(f);
+	scriptSteps = count;
+	scriptNext = 0;
+	scriptFirst = statNow();
+	return true;
+}
 
 /**
- * Checks for user input: esc and mouseclick exit the program, space
- * should induce anoter iteration
+ * Returns the input of the next action of the script, INP_QUIT after the
+ * last one. The previous action is over once genplant waits for input.
+ */
+static int scriptInput() {
+	double now = statNow();
+	int input;
+
+	if (scriptNext == 0) {
+		scriptFirst = now - scriptFirst;
+	} else {
+		script[scriptNext - 1].seconds = now - dequeued;
+	}
+	while (scriptNext < scriptSteps) {
+		dequeued = statNow();
+		input = translateEvent(&script[scriptNext++].event);
+		if (input != INP_NULL) {
+			return input;
+		}
+	}
+	return INP_QUIT;
+}
+
+/**
+ * Prints how long each action of the input script took to stdout and
+ * frees the script
+ */
+void inputScriptEnd() {
+	double total = scriptFirst;
+	int i;
+
+	if (script == NULL) {
+		return;
+	}
+	printf("%5s %5s  %-24s %10s\n", "step", "line", "action", "ms");
+	printf("%5d %5s  %-24s %10.2f\n", 0, "-", "(first frame)",
+		scriptFirst * 1e3);
+	for (i = 0; i < scriptNext; i++) {
+		printf("%5d %5d  %-24.24s %10.2f\n", i + 1, script[i].line,
+			script[i].action, script[i].seconds * 1e3);
+		total += script[i].seconds;
+	}
+	printf("%5s %5s  %-24s %10.2f\n", "total", "", "", total * 1e3);
+	fflush(stdout);
+	memFree(script);
+	script = NULL;
+}
+
+/**
+ * Checks for user input: esc exits the program, space should induce
+ * anoter iteration. Blocks until there is input.
  */
 int checkInput() {
 	static SDL_Event event;
+	int input;
+	double span;
+
+	if (script != NULL) {
+		return scriptInput();
+	}
+	span = traceBegin();
 
 	while (SDL_WaitEvent(&event)) {
-		/* closed window */
-		if (event.type == SDL_QUIT) {
- 			return INP_QUIT;
+		traceEnd("input wait", span);
+		span = traceBegin();
+		dequeued = statNow();
+		input = translateEvent(&event);
+		if (input != INP_NULL) {
+			return input;
 		}
+	}
 
-		/* mouse click */
-		if (event.type == SDL_MOUSEBUTTONDOWN) {
-			return INP_QUIT;
-		}
+	return INP_NULL;
+}
+
+/**
+ * Like checkInput, but returns INP_NULL instead of waiting if no more
+ * input is queued. Used to drain all input that arrived while rendering.
+ */
+int pollInput() {
+	static SDL_Event event;
+	int input;
 
-		/* key press */
-		if (event.type == SDL_KEYDOWN) {
-			switch(event.key.keysym.sym) {
-				case SDLK_SPACE:
-					return INP_CONT;
-					break;
-				case SDLK_ESCAPE:
-					return INP_QUIT;
-				case SDLK_h:
-					return INP_TOGGLEHELP;
-				case SDLK_a:
-					return INP_INCANGLE;
-				case SDLK_s:
-					return INP_DECANGLE;
-				case SDLK_q:
-					return INP_INCLINELEN;
-				case SDLK_w:
-					return INP_DECLINELEN;
-				case SDLK_r:
-					return INP_INCRANDANGLE;
-				case SDLK_t:
-					return INP_RESETRANDANGLE;
-				case SDLK_UP:
-					return INP_DECYOFFSET;
-				case SDLK_DOWN:
-					return INP_INCYOFFSET;
-				case SDLK_LEFT:
-					return INP_DECXOFFSET;
-				case SDLK_RIGHT:
-					return INP_INCXOFFSET;
-				case SDLK_o:
-					return INP_RESETOFFSET;
-#ifdef VRML
-				case SDLK_m:
-					return INP_EXPORTVRML;
-#endif
-				default: break;
-			}
+	/* every action of a script is shown on its own */
+	if (script != NULL) {
+		return INP_NULL;
+	}
+	while (SDL_PollEvent(&event)) {
+		dequeued = statNow();
+		input = translateEvent(&event);
+		if (input != INP_NULL) {
+			return input;
 		}
 	}
 
 	return INP_NULL;
 }
 
+
+/**
+ * Checks if the user pressed a key or a mouse button (or closed the
+ * window) without removing the event from the queue. Used to abort
+ * long renderings, so events that are not an input, like keys without
+ * a function, are ignored.
+ */
+bool inputPending() {
+	SDL_Event events[INPUT_PEEK];
+	int count;
+	int i;
+
+	/* a script waits for every action to be drawn completely */
+	if (script != NULL) {
+		return false;
+	}
+	SDL_PumpEvents();
+	count = SDL_PeepEvents(events, INPUT_PEEK, SDL_PEEKEVENT, SDL_QUITMASK |
+		SDL_KEYDOWNMASK | SDL_MOUSEBUTTONDOWNMASK);
+	/* the mouse position this stores is stored again when the event is
+	 * taken from the queue */
+	for (i = 0; i < count; i++) {
+		if (translateEvent(&events[i]) != INP_NULL) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Returns the position of the mouse at the last INP_ZOOMIN, INP_ZOOMOUT,
+ * INP_DRAG or INP_INSPECT
+ */
+void inputMouse(int *x, int *y) {
+	*x = mouseX;
+	*y = mouseY;
+}
+
+/**
+ * Returns when the event of the last input was taken from the queue, in
+ * the time of statNow()
+ */
+double inputTime() {
+	return dequeued;
+}
+
+/**
+ * Returns how far the mouse was moved by the last INP_DRAG
+ */
+void inputDrag(int *dx, int *dy) {
+	*dx = dragX;
+	*dy = dragY;
+}
+
+/**
+ * Returns the new size of the window at the last INP_RESIZE
+ */
+void inputSize(int *width, int *height) {
+	*width = resizeWidth;
+	*height = resizeHeight;
+}
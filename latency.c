@@ -0,0 +1,251 @@
+/* latency.c
+ * Time from input to the frame that shows it
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "input.h"
+#include "latency.h"
+#include "stats.h"
+
+/* Each power of two of microseconds is split into this many buckets, so
+ * the percentiles are off by less than 1/16 */
+#define LAT_SUBBUCKETS 16
+/* Latencies above 2^LAT_OCTAVES microseconds all land in the last bucket */
+#define LAT_OCTAVES 32
+#define LAT_BUCKETS ((LAT_OCTAVES - 3) * LAT_SUBBUCKETS)
+
+/**
+ * Latencies of one kind of input, in microseconds
+ */
+typedef struct {
+	unsigned long count;
+	unsigned long buckets[LAT_BUCKETS];
+	double sum;
+	double max;
+} Histogram;
+
+static const char *names[LAT_KINDS] = {"pan", "zoom", "angle", "length",
+	"iteration", "export"};
+
+/** Nothing is measured unless a report was asked for */
+static bool enabled = false;
+static Histogram histograms[LAT_KINDS];
+/** When the oldest input of each kind that is not shown yet was dequeued,
+ * negative if there is none */
+static double pending[LAT_KINDS];
+
+/**
+ * Starts measuring the latencies
+ */
+void latencyEnable() {
+	int i;
+
+	memset(histograms, 0, sizeof(histograms));
+	for (i = 0; i < LAT_KINDS; i++) {
+		pending[i] = -1.;
+	}
+	enabled = true;
+}
+
+/**
+ * Returns which of the latencyKinds an input is, -1 if it is not measured
+ */
+static int inputKind(int input) {
+	switch (input) {
+		case INP_INCXOFFSET:
+		case INP_DECXOFFSET:
+		case INP_INCYOFFSET:
+		case INP_DECYOFFSET:
+		case INP_RESETOFFSET:
+		case INP_DRAG:
+			return LAT_PAN;
+		case INP_ZOOMIN:
+		case INP_ZOOMOUT:
+			return LAT_ZOOM;
+		case INP_INCANGLE:
+		case INP_DECANGLE:
+		case INP_INCRANDANGLE:
+		case INP_RESETRANDANGLE:
+			return LAT_ANGLE;
+		case INP_INCLINELEN:
+		case INP_DECLINELEN:
+			return LAT_LENGTH;
+		case INP_CONT:
+		case INP_BACK:
+			return LAT_ITERATION;
+		case INP_EXPORT:
+			return LAT_EXPORT;
+		default:
+			return -1;
+	}
+}
+
+/**
+ * Returns the bucket of a latency in microseconds
+ */
+static int bucketOf(double us) {
+	unsigned long v;
+	int octave = 0;
+
+	if (us >= (double)(1ul << (LAT_OCTAVES - 1)) * 2.) {
+		return LAT_BUCKETS - 1;
+	}
+	v = (unsigned long)us;
+	if (v < LAT_SUBBUCKETS) {
+		return (int)v;
+	}
+	while ((v >> octave) >= 2 * LAT_SUBBUCKETS) {
+		octave++;
+	}
+	return (octave + 1) * LAT_SUBBUCKETS +
+		(int)(v >> octave) - LAT_SUBBUCKETS;
+}
+
+/**
+ * Returns the middle of a bucket in microseconds
+ */
+static double bucketMiddle(int bucket) {
+	int octave;
+
+	if (bucket < LAT_SUBBUCKETS) {
+		return bucket + .5;
+	}
+	octave = bucket / LAT_SUBBUCKETS - 1;
+	return (double)((unsigned long)(bucket % LAT_SUBBUCKETS +
+		LAT_SUBBUCKETS) << octave) + (double)(1ul << octave) / 2.;
+}
+
+/**
+ * Returns the latency below which the given fraction of the inputs were
+ * shown, in milliseconds
+ */
+static double percentile(Histogram *histogram, double fraction) {
+	unsigned long seen = 0;
+	unsigned long rank = (unsigned long)(fraction * histogram->count + .999);
+	double us;
+	int i;
+
+	for (i = 0; i < LAT_BUCKETS - 1; i++) {
+		seen += histogram->buckets[i];
+		if (seen >= rank) {
+			break;
+		}
+	}
+	us = bucketMiddle(i);
+	return (us < histogram->max ? us : histogram->max) / 1e3;
+}
+
+/**
+ * Notes an input that was taken from the event queue at the given time
+ * (statNow()) and will change the next frame. Of several inputs of the
+ * same kind that are shown together, the oldest one is measured.
+ */
+void latencyInput(int input, double dequeued) {
+	int kind = inputKind(input);
+
+	if (enabled && kind >= 0 && pending[kind] < 0.) {
+		pending[kind] = dequeued;
+	}
+}
+
+/**
+ * Records the latency of a noted input of the given kind
+ */
+static void record(int kind, double now) {
+	double us;
+
+	if (pending[kind] < 0.) {
+		return;
+	}
+	us = (now - pending[kind]) * 1e6;
+	histograms[kind].buckets[bucketOf(us)]++;
+	histograms[kind].count++;
+	histograms[kind].sum += us;
+	if (us > histograms[kind].max) {
+		histograms[kind].max = us;
+	}
+	pending[kind] = -1.;
+}
+
+/**
+ * Records the latencies of all noted inputs, called when a frame showing
+ * them is on the screen. A preview of a lower iteration counts as well,
+ * as it is the first response the user sees.
+ */
+void latencyPresented() {
+	double now;
+	int i;
+
+	if (!enabled) {
+		return;
+	}
+	now = statNow();
+	for (i = 0; i < LAT_KINDS; i++) {
+		record(i, now);
+	}
+}
+
+/**
+ * Records the latency of one input whose result was shown on its own,
+ * like the status line of an export, without the other noted inputs
+ */
+void latencyShown(int input) {
+	int kind = inputKind(input);
+
+	if (enabled && kind >= 0) {
+		record(kind, statNow());
+	}
+}
+
+/**
+ * Writes the percentiles of the latencies of each kind of input as table
+ * to a file, - writes them to stdout. Returns false if the file could not
+ * be written.
+ */
+bool latencyWrite(char *filename) {
+	FILE *f = stdout;
+	Histogram *h;
+	int i;
+
+	if (strcmp(filename, "-") != 0) {
+		f = fopen(filename, "w");
+		if (f == NULL) {
+			perror(filename);
+			return false;
+		}
+	}
+	fprintf(f, "%-10s %7s %9s %9s %9s %9s %9s\n", "input", "count",
+		"mean ms", "p50 ms", "p95 ms", "p99 ms", "max ms");
+	for (i = 0; i < LAT_KINDS; i++) {
+		h = &histograms[i];
+		if (h->count == 0) {
+			continue;
+		}
+		fprintf(f, "%-10s %7lu %9.2f %9.2f %9.2f %9.2f %9.2f\n", names[i],
+			h->count, h->sum / h->count / 1e3, percentile(h, .5),
+			percentile(h, .95), percentile(h, .99), h->max / 1e3);
+	}
+	if (f == stdout) {
+		fflush(f);
+		return true;
+	}
+	return fclose(f) == 0;
+}
@@ -86,8 +86,8 @@ void delete(List xs) {
 	if (!isEmpty(xs)) {
 		delete(xs->tail);
 	}
-	free(xs->head);
-	free(xs);
+	memFree(xs->head);
+	memFree(xs);
 }
 
 /**
@@ -103,7 +103,8 @@ void pushBack(List xs, Object x) {
 }
 
 /**
- * Remove the last element from the list and return it
+ * Remove the last element from the list and return it. The caller
+ * is responsible for freeing the returned object.
  */
 Object popBack(List xs) {
 	if (isEmpty(xs)) {
@@ -111,6 +112,8 @@ Object popBack(List xs) {
 	}
 	if (isEmpty(xs->tail)) {
 		Object x = xs->tail->head;
+		/* the element is handed to the caller and must not be freed */
+		xs->tail->head = NULL;
 		delete(xs->tail);
 		xs->tail = NULL;
 		return x;
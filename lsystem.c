@@ -22,8 +22,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 #include "lsystem.h"
 #include "list.h"
+#include "stats.h"
+#include "trace.h"
 #include "tools.h"
 
 /**
@@ -59,59 +64,173 @@ Object stateToObject(State n) {
 }
 
 /**
- * Iterate a L-System and return the result
- * In "F->F+F", lsys would be "F" and fTo would be "F+F".
+ * Returns the number of Fs in a string
  */
-char *lSystem(char *lsys, char *fTo) {
-	int numF = 0;
-	int i;
-	int j;
-	int newlen;
-	char *result;
+static size_t countF(char *s) {
+	size_t n = 0;
 
-	/* 1. check number of Fs in fTo */
-	for (i = 0; i < strlen(lsys); i++) {
-		if (lsys[i] == 'F') {
-			numF++;
+	for (; *s != '\0'; s++) {
+		if (*s == 'F') {
+			n++;
 		}
 	}
-	if (numF == 0) {
-		return lsys;
+	return n;
+}
+
+/**
+ * Returns the length of the string that one iteration of the L-System
+ * generates, without the terminating zero
+ */
+size_t lSysLength(char *lsys, char *fTo) {
+	size_t numF = countF(lsys);
+
+	return numF * strlen(fTo) + (strlen(lsys) - numF);
+}
+
+/**
+ * Allocates the buffer for a derived string. Large buffers are backed by
+ * huge pages where the system supports them, so writing them faults in
+ * far fewer pages.
+ */
+static char *newString(size_t size) {
+	char *result;
+#ifdef MADV_HUGEPAGE
+	size_t first;
+	size_t last;
+#endif
+
+	result = newn(char, size);
+#ifdef MADV_HUGEPAGE
+	if (size >= LSYS_HUGEPAGE) {
+		/* only the whole huge pages inside the buffer can be used */
+		first = ((size_t)result + LSYS_HUGEPAGE - 1) & ~(LSYS_HUGEPAGE - 1);
+		last = ((size_t)result + size) & ~(LSYS_HUGEPAGE - 1);
+		if (last > first) {
+			madvise((void*)first, last - first, MADV_HUGEPAGE);
+		}
 	}
+#endif
+	return result;
+}
 
-	/* 2. allocate memory for result string */
-	newlen = (numF * strlen(fTo)) + (strlen(lsys) - numF);
-	result = (char*)calloc(1, (newlen + 1) * sizeof(char));
+/**
+ * Writes one iteration of the L-System of length len into result, which
+ * has to be large enough. Returns false if *cancel was set meanwhile.
+ */
+static bool deriveInto(char *lsys, size_t len, char *fTo, char *result,
+		volatile bool *cancel) {
+	size_t flen = strlen(fTo);
+	size_t i;
+	size_t j;
+	double start = 0.;
+	double span = traceBegin();
+	PerfCounts counts;
+	bool counted = statCountBegin(&counts);
+	bool measured = statEnabled();
+	bool canceled = false;
 
-	/* 3. generate result string */
-	for (i = 0, j = 0; lsys[i] != 0; i++) {
+	if (measured) {
+		start = statNow();
+	}
+	for (i = 0, j = 0; i < len; i++) {
 		if (lsys[i] != 'F') {
-			result[j] = lsys[i];
+			result[j++] = lsys[i];
 		} else {
-			strncpy(result + j, fTo, strlen(fTo));
-			j = j + strlen(fTo) - 1;
+			memcpy(result + j, fTo, flen);
+			j += flen;
+		}
+		if ((i & 0xFFFF) == 0 && cancel != NULL && *cancel) {
+			canceled = true;
+			break;
 		}
-		j++;
 	}
-	
+	if (!canceled) {
+		result[j] = '\0';
+	}
+	/* a canceled derivation is traced, but the last complete one stays
+	 * in the statistics */
+	if (measured && !canceled) {
+		statDerived(statNow() - start, (unsigned long)j);
+		statCountEnd(STAT_DERIVE, counted ? &counts : NULL);
+	}
+	traceEnd("derive", span);
+	return !canceled;
+}
+
+/**
+ * Iterate a L-System and return the result
+ * In "F->F+F", lsys would be "F" and fTo would be "F+F".
+ */
+char *lSystem(char *lsys, char *fTo) {
+	return lSysDerive(lsys, fTo, NULL);
+}
+
+/**
+ * Like lSystem(), but stops and returns NULL as soon as *cancel is set.
+ * This allows to derive an iteration on another thread.
+ */
+char *lSysDerive(char *lsys, char *fTo, volatile bool *cancel) {
+	char *result;
+
+	if (strchr(lsys, 'F') == NULL) {
+		return lsys;
+	}
+
+	result = newString(lSysLength(lsys, fTo) + 1);
+	if (!deriveInto(lsys, strlen(lsys), fTo, result, cancel)) {
+		memFree(result);
+		return NULL;
+	}
 	return result;
 }
 
 /**
  * Iterate a L-System n times and return the result
  * In "F->F+F", start would be "F" and fTo would be "F+F".
+ * The iterations are derived alternately into two buffers, which are
+ * sized in advance from the lengths the iterations will have, so at most
+ * two allocations are made. start is returned if it has no Fs.
  */
 char *lSysIterate(char *start, char *fTo, int iterations) {
-	int i;
+	size_t flen = strlen(fTo);
+	size_t fs = countF(fTo);
+	size_t len = strlen(start);
+	size_t numF = countF(start);
+	size_t size[2];
+	char *buf[2];
 	char *it = start;
-	char *old;
-	for (i = 0; i < iterations; i++) {
-		old = it;
-		it = lSystem(it, fTo);
-		if (old != start) {
-			free(old);
+	int steps;
+	int i;
+
+	/* every F grows by the length of fTo, the other symbols are kept;
+	 * without Fs, the string does not change anymore */
+	size[0] = 0;
+	size[1] = 0;
+	for (steps = 0; steps < iterations && numF > 0; steps++) {
+		len = len - numF + numF * flen;
+		numF *= fs;
+		if (len + 1 > size[steps % 2]) {
+			size[steps % 2] = len + 1;
 		}
 	}
+	if (steps == 0) {
+		return start;
+	}
+	buf[0] = newString(size[0]);
+	buf[1] = NULL;
+	if (steps > 1) {
+		buf[1] = newString(size[1]);
+	}
+
+	len = strlen(start);
+	numF = countF(start);
+	for (i = 0; i < steps; i++) {
+		deriveInto(it, len, fTo, buf[i % 2], NULL);
+		it = buf[i % 2];
+		len = len - numF + numF * flen;
+		numF *= fs;
+	}
+	memFree(buf[steps % 2]);
 	return it;
 }
 
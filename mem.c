@@ -0,0 +1,139 @@
+/* mem.c
+ * Counted allocations
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "mem.h"
+
+/**
+ * Stored in front of every allocation to know its size when it is freed,
+ * aligned like malloc() aligns
+ */
+typedef union {
+	size_t size;
+	long double align;
+	void *pointer;
+} MemHeader;
+
+/** Updated by all threads with atomic operations */
+static volatile unsigned long calls = 0;
+static volatile unsigned long bytes = 0;
+static volatile unsigned long live = 0;
+static volatile unsigned long peak = 0;
+
+/**
+ * Counts an allocation of size bytes
+ */
+static void memAdd(size_t size) {
+	unsigned long now;
+	unsigned long highest;
+
+	__sync_fetch_and_add(&calls, 1ul);
+	__sync_fetch_and_add(&bytes, (unsigned long)size);
+	now = __sync_add_and_fetch(&live, (unsigned long)size);
+	highest = peak;
+	while (now > highest &&
+			!__sync_bool_compare_and_swap(&peak, highest, now)) {
+		highest = peak;
+	}
+}
+
+/**
+ * Allocates memory like malloc(), counting it. The memory has to be freed
+ * with memFree().
+ */
+void *memAlloc(size_t size) {
+	MemHeader *header = (MemHeader*)malloc(sizeof(MemHeader) + size);
+
+	if (header == NULL) {
+		return NULL;
+	}
+	header->size = size;
+	memAdd(size);
+	return header + 1;
+}
+
+/**
+ * Allocates memory like memAlloc(), but exits the program if there is
+ * not enough of it
+ */
+void *memAllocOrDie(size_t size) {
+	void *p = memAlloc(size);
+
+	if (p == NULL) {
+		fprintf(stderr, "malloc() failed");
+		exit(EXIT_FAILURE);
+	}
+	return p;
+}
+
+/**
+ * Resizes memory from memAlloc() like realloc(), NULL allocates new memory
+ */
+void *memRealloc(void *p, size_t size) {
+	MemHeader *header;
+	size_t old;
+
+	if (p == NULL) {
+		return memAlloc(size);
+	}
+	header = (MemHeader*)p - 1;
+	old = header->size;
+	header = (MemHeader*)realloc(header, sizeof(MemHeader) + size);
+	if (header == NULL) {
+		return NULL;
+	}
+	header->size = size;
+	__sync_fetch_and_sub(&live, (unsigned long)old);
+	memAdd(size);
+	return header + 1;
+}
+
+/**
+ * Frees memory from memAlloc() or memRealloc()
+ */
+void memFree(void *p) {
+	MemHeader *header;
+
+	if (p == NULL) {
+		return;
+	}
+	header = (MemHeader*)p - 1;
+	__sync_fetch_and_sub(&live, (unsigned long)header->size);
+	free(header);
+}
+
+/**
+ * Copies the current counts
+ */
+void memGetStats(MemStats *stats) {
+	stats->calls = calls;
+	stats->bytes = bytes;
+	stats->live = live;
+	stats->peak = peak;
+}
+
+/**
+ * Starts measuring the peak from the memory that is allocated now
+ */
+void memResetPeak() {
+	peak = live;
+}
@@ -0,0 +1,357 @@
+/* meshexport.c
+ * Binary PLY and glTF export of the segment buffer
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "SDL.h"
+#include "meshexport.h"
+#include "export.h"
+#include "tools.h"
+
+/*
+ * Both formats store the segments as vertex and index arrays. The arrays
+ * are generated in blocks of MESH_CHUNK segments, which are written with
+ * writev() directly from the block buffers. The plant lies in the x/y
+ * plane with y pointing up.
+ * Branches are either exported as lines (two vertices per segment) or
+ * extruded to tubes with TUBE_SIDES sides (2 * TUBE_SIDES vertices and
+ * triangles per segment).
+ */
+
+/**
+ * Converts an array of 32 bit words to little endian in place
+ */
+static void toLittleEndian(void *data, int words) {
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+	Uint8 *p = (Uint8*)data;
+	Uint8 t;
+	int i;
+
+	for (i = 0; i < words; i++, p += 4) {
+		t = p[0]; p[0] = p[3]; p[3] = t;
+		t = p[1]; p[1] = p[2]; p[2] = t;
+	}
+#endif
+}
+
+/**
+ * Returns the number of vertices written per segment
+ */
+static int vertsPerSegment(double tubeWidth) {
+	return tubeWidth > 0 ? 2 * TUBE_SIDES : 2;
+}
+
+/**
+ * Returns the number of primitives (lines or triangles) per segment
+ */
+static int primsPerSegment(double tubeWidth) {
+	return tubeWidth > 0 ? 2 * TUBE_SIDES : 1;
+}
+
+/**
+ * Fills v with the vertices of segments first..last-1 and returns the
+ * number of floats written
+ */
+static int fillVertices(float *v, Geometry *geo, int first, int last,
+		double tubeWidth) {
+	Segment *seg;
+	double dx, dy, l, c, s;
+	int n = 0;
+	int i, k;
+
+	for (i = first; i < last; i++) {
+		seg = &geo->segs[i];
+		if (tubeWidth <= 0) {
+			v[n++] = seg->x1; v[n++] = -seg->y1; v[n++] = 0.f;
+			v[n++] = seg->x2; v[n++] = -seg->y2; v[n++] = 0.f;
+			continue;
+		}
+		/* ring of vertices around both ends, spanned by the normal
+		 * of the segment in the x/y plane and the z axis */
+		dx = seg->x2 - seg->x1;
+		dy = seg->y1 - seg->y2;
+		l = sqrt(dx * dx + dy * dy);
+		if (l > 0) {
+			dx /= l;
+			dy /= l;
+		} else {
+			dx = 0.;
+			dy = 1.;
+		}
+		for (k = 0; k < 2 * TUBE_SIDES; k++) {
+			c = cos(2 * M_PI * (k % TUBE_SIDES) / TUBE_SIDES) * tubeWidth / 2;
+			s = sin(2 * M_PI * (k % TUBE_SIDES) / TUBE_SIDES) * tubeWidth / 2;
+			v[n++] = (k < TUBE_SIDES ? seg->x1 : seg->x2) - dy * c;
+			v[n++] = (k < TUBE_SIDES ? -seg->y1 : -seg->y2) + dx * c;
+			v[n++] = s;
+		}
+	}
+	return n;
+}
+
+/**
+ * Fills idx with the vertex indices of the primitives of segments
+ * first..last-1 and returns the number of indices written
+ */
+static int fillIndices(Uint32 *idx, int first, int last, double tubeWidth) {
+	Uint32 base;
+	int n = 0;
+	int i, k;
+
+	for (i = first; i < last; i++) {
+		base = i * vertsPerSegment(tubeWidth);
+		if (tubeWidth <= 0) {
+			idx[n++] = base;
+			idx[n++] = base + 1;
+			continue;
+		}
+		for (k = 0; k < TUBE_SIDES; k++) {
+			idx[n++] = base + k;
+			idx[n++] = base + TUBE_SIDES + k;
+			idx[n++] = base + (k + 1) % TUBE_SIDES;
+			idx[n++] = base + (k + 1) % TUBE_SIDES;
+			idx[n++] = base + TUBE_SIDES + k;
+			idx[n++] = base + TUBE_SIDES + (k + 1) % TUBE_SIDES;
+		}
+	}
+	return n;
+}
+
+/**
+ * Writes the vertex array of all segments, block by block. The indices
+ * are written afterwards by writeIndices().
+ */
+static void writeVertices(Writer *w, Geometry *geo, double tubeWidth,
+		float *buf) {
+	struct iovec iov;
+	int i, n;
+
+	for (i = 0; i < geo->count && !w->failed; i += MESH_CHUNK) {
+		n = fillVertices(buf, geo, i, i + MESH_CHUNK < geo->count ?
+			i + MESH_CHUNK : geo->count, tubeWidth);
+		toLittleEndian(buf, n);
+		iov.iov_base = buf;
+		iov.iov_len = n * sizeof(float);
+		wrWritev(w, &iov, 1);
+		exportProgress(w, i / 2, geo->count);
+	}
+}
+
+/**
+ * PLY: lines are written as edges, tubes as triangle faces
+ */
+static void writePLYIndices(Writer *w, Geometry *geo, double tubeWidth,
+		Uint32 *idx, Uint8 *faces) {
+	struct iovec iov;
+	int i, j, n;
+	Uint8 *p;
+
+	for (i = 0; i < geo->count && !w->failed; i += MESH_CHUNK) {
+		n = fillIndices(idx, i, i + MESH_CHUNK < geo->count ?
+			i + MESH_CHUNK : geo->count, tubeWidth);
+		toLittleEndian(idx, n);
+		if (tubeWidth <= 0) {
+			iov.iov_base = idx;
+			iov.iov_len = n * sizeof(Uint32);
+		} else {
+			/* faces are stored as a count byte followed by three
+			 * indices, without padding */
+			for (j = 0, p = faces; j < n; j += 3, p += 13) {
+				p[0] = 3;
+				memcpy(p + 1, &idx[j], 3 * sizeof(Uint32));
+			}
+			iov.iov_base = faces;
+			iov.iov_len = p - faces;
+		}
+		wrWritev(w, &iov, 1);
+		exportProgress(w, (geo->count + i) / 2, geo->count);
+	}
+}
+
+/**
+ * Exports the segments as binary PLY
+ */
+void writePLY(Writer *w, Geometry *geo, double tubeWidth) {
+	float *buf;
+	Uint32 *idx;
+	Uint8 *faces;
+
+	buf = newn(float, MESH_CHUNK * 2 * TUBE_SIDES * 3);
+	idx = newn(Uint32, MESH_CHUNK * 6 * TUBE_SIDES);
+	faces = newn(Uint8, MESH_CHUNK * 2 * TUBE_SIDES * 13);
+	wrPuts(w, "ply\n"
+		"format binary_little_endian 1.0\n"
+		"comment genplant\n"
+		"element vertex ");
+	wrInt(w, (long)geo->count * vertsPerSegment(tubeWidth));
+	wrPuts(w, "\n"
+		"property float x\n"
+		"property float y\n"
+		"property float z\n");
+	if (tubeWidth <= 0) {
+		wrPuts(w, "element edge ");
+		wrInt(w, geo->count);
+		wrPuts(w, "\n"
+			"property int vertex1\n"
+			"property int vertex2\n");
+	} else {
+		wrPuts(w, "element face ");
+		wrInt(w, (long)geo->count * primsPerSegment(tubeWidth));
+		wrPuts(w, "\n"
+			"property list uchar int vertex_indices\n");
+	}
+	wrPuts(w, "end_header\n");
+
+	writeVertices(w, geo, tubeWidth, buf);
+	writePLYIndices(w, geo, tubeWidth, idx, faces);
+	memFree(buf);
+	memFree(idx);
+	memFree(faces);
+}
+
+/**
+ * Computes the bounding box of all vertices, using buf as scratch space
+ */
+static void findBounds(Geometry *geo, double tubeWidth, float *buf,
+		float *min, float *max) {
+	int i, j, k, n;
+
+	for (k = 0; k < 3; k++) {
+		min[k] = 0.f;
+		max[k] = 0.f;
+	}
+	for (i = 0; i < geo->count; i += MESH_CHUNK) {
+		n = fillVertices(buf, geo, i, i + MESH_CHUNK < geo->count ?
+			i + MESH_CHUNK : geo->count, tubeWidth);
+		for (j = 0; j < n; j++) {
+			k = j % 3;
+			if ((i == 0 && j < 3) || buf[j] < min[k]) {
+				min[k] = buf[j];
+			}
+			if ((i == 0 && j < 3) || buf[j] > max[k]) {
+				max[k] = buf[j];
+			}
+		}
+	}
+}
+
+/**
+ * Exports the segments as binary glTF 2.0 (.glb) with a single mesh.
+ * Without segments, the file only has an empty scene, because glTF does
+ * not allow accessors without elements.
+ */
+void writeGLB(Writer *w, Geometry *geo, double tubeWidth) {
+	float *buf;
+	Uint32 *idx;
+	unsigned long numVerts = (unsigned long)geo->count *
+		vertsPerSegment(tubeWidth);
+	unsigned long numIdx = (unsigned long)geo->count *
+		primsPerSegment(tubeWidth) * (tubeWidth > 0 ? 3 : 2);
+	unsigned long binLen = numVerts * 12 + numIdx * 4;
+	float min[3];
+	float max[3];
+	char json[1024];
+	Uint32 header[5];
+	struct iovec iov;
+	int jsonLen;
+	int i, n;
+
+	if (geo->count == 0) {
+		jsonLen = snprintf(json, sizeof(json),
+			"{\"asset\":{\"version\":\"2.0\",\"generator\":\"genplant\"},"
+			"\"scene\":0,\"scenes\":[{}]}");
+		while (jsonLen % 4 != 0) {
+			json[jsonLen++] = ' ';
+		}
+		header[0] = 0x46546C67;	/* "glTF" */
+		header[1] = 2;
+		header[2] = 12 + 8 + jsonLen;
+		header[3] = jsonLen;
+		header[4] = 0x4E4F534A;	/* "JSON" */
+		toLittleEndian(header, 5);
+		wrWrite(w, (char*)header, sizeof(header));
+		wrWrite(w, json, jsonLen);
+		wrFlush(w);
+		return;
+	}
+
+	buf = newn(float, MESH_CHUNK * 2 * TUBE_SIDES * 3);
+	idx = newn(Uint32, MESH_CHUNK * 6 * TUBE_SIDES);
+
+	/* glTF requires the exact bounds of the positions */
+	findBounds(geo, tubeWidth, buf, min, max);
+
+	jsonLen = snprintf(json, sizeof(json),
+		"{\"asset\":{\"version\":\"2.0\",\"generator\":\"genplant\"},"
+		"\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+		"\"nodes\":[{\"mesh\":0}],"
+		"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0},"
+		"\"indices\":1,\"mode\":%d}]}],"
+		"\"buffers\":[{\"byteLength\":%lu}],"
+		"\"bufferViews\":["
+		"{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%lu,"
+		"\"target\":34962},"
+		"{\"buffer\":0,\"byteOffset\":%lu,\"byteLength\":%lu,"
+		"\"target\":34963}],",
+		tubeWidth > 0 ? 4 : 1, binLen, numVerts * 12, numVerts * 12,
+		numIdx * 4);
+	jsonLen += snprintf(json + jsonLen, sizeof(json) - jsonLen,
+		"\"accessors\":["
+		"{\"bufferView\":0,\"componentType\":5126,\"count\":%lu,"
+		"\"type\":\"VEC3\",\"min\":[%.9g,%.9g,%.9g],"
+		"\"max\":[%.9g,%.9g,%.9g]},"
+		"{\"bufferView\":1,\"componentType\":5125,\"count\":%lu,"
+		"\"type\":\"SCALAR\"}]}",
+		numVerts, min[0], min[1], min[2], max[0], max[1], max[2], numIdx);
+	/* chunks are padded to 4 bytes, JSON with spaces */
+	while (jsonLen % 4 != 0) {
+		json[jsonLen++] = ' ';
+	}
+
+	header[0] = 0x46546C67;	/* "glTF" */
+	header[1] = 2;
+	header[2] = 12 + 8 + jsonLen + 8 + binLen;
+	header[3] = jsonLen;
+	header[4] = 0x4E4F534A;	/* "JSON" */
+	toLittleEndian(header, 5);
+	wrWrite(w, (char*)header, sizeof(header));
+	wrWrite(w, json, jsonLen);
+	header[0] = binLen;
+	header[1] = 0x004E4942;	/* "BIN" */
+	toLittleEndian(header, 2);
+	wrWrite(w, (char*)header, 2 * sizeof(Uint32));
+
+	/* the binary chunk holds all positions followed by all indices;
+	 * both are multiples of 4 bytes, so no padding is needed */
+	writeVertices(w, geo, tubeWidth, buf);
+	for (i = 0; i < geo->count && !w->failed; i += MESH_CHUNK) {
+		n = fillIndices(idx, i, i + MESH_CHUNK < geo->count ?
+			i + MESH_CHUNK : geo->count, tubeWidth);
+		toLittleEndian(idx, n);
+		iov.iov_base = idx;
+		iov.iov_len = n * sizeof(Uint32);
+		wrWritev(w, &iov, 1);
+		exportProgress(w, (geo->count + i) / 2, geo->count);
+	}
+	wrFlush(w);
+	memFree(buf);
+	memFree(idx);
+}
@@ -0,0 +1,75 @@
+/* patterns.c
+ * Plant patterns listed in the README
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "patterns.h"
+
+/**
+ * Reads the patterns from the "Interesting patterns" section of the
+ * README, i.e. all lines like ./genplant -s "F[+F]F" -a 90 -x 7, with
+ * the default angle and factor where they are not given. Returns the
+ * number of patterns, at most max, or -1 if the file could not be read.
+ */
+int readPatterns(char *filename, Pattern *patterns, int max) {
+	FILE *f = fopen(filename, "r");
+	char line[300];
+	char *p;
+	char *end;
+	bool section = false;
+	int count = 0;
+
+	if (f == NULL) {
+		return -1;
+	}
+	while (fgets(line, 300, f) != NULL && count < max) {
+		if (strncmp(line, "Interesting patterns", 20) == 0) {
+			section = true;
+			continue;
+		}
+		if (!section || strncmp(line, "./genplant", 10) != 0) {
+			if (section && line[0] != '\n' && line[0] != '=') {
+				break;
+			}
+			continue;
+		}
+		p = strstr(line, "-s \"");
+		if (p == NULL || (end = strchr(p + 4, '"')) == NULL ||
+				end - p - 4 >= 100) {
+			continue;
+		}
+		memcpy(patterns[count].rule, p + 4, end - p - 4);
+		patterns[count].rule[end - p - 4] = '\0';
+		patterns[count].angle = 20.;
+		patterns[count].factor = 7;
+		if ((p = strstr(end, " -a ")) != NULL) {
+			patterns[count].angle = atof(p + 4);
+		}
+		if ((p = strstr(end, " -x ")) != NULL) {
+			patterns[count].factor = atoi(p + 4);
+		}
+		count++;
+	}
+	fclose(f);
+	return count;
+}
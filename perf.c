@@ -0,0 +1,192 @@
+/* perf.c
+ * Hardware performance counters around the drawing stages
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "SDL.h"
+#include "perf.h"
+
+/** File descriptors of the counters, -1 for events that are not counted.
+ * They form one group, so they are always counted over the same time. */
+static int fds[PERF_EVENTS] = {-1, -1, -1, -1};
+/** The first counter that could be opened, which reads the whole group */
+static int leader = -1;
+/** Position of each counter in the group */
+static int slots[PERF_EVENTS];
+static int members = 0;
+/** The counters only count the thread that opened them */
+static Uint32 owner;
+static bool opened = false;
+
+/**
+ * Opens counters for cycles, instructions, cache misses and branch
+ * misses of the calling thread in user space, as one group led by the
+ * first of them that is available. Only this thread can read them
+ * afterwards. Returns false if none of them is available, e.g. on
+ * other systems than Linux, in virtual machines without access to the
+ * counters or if perf_event_paranoid forbids them.
+ */
+bool perfOpen() {
+#ifdef __linux__
+	static const unsigned long configs[PERF_EVENTS] = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+	struct perf_event_attr attr;
+	int error = 0;
+	int i;
+
+	for (i = 0; i < PERF_EVENTS; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = configs[i];
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP |
+			PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, leader,
+			0);
+		if (fds[i] < 0) {
+			error = errno;
+			continue;
+		}
+		if (leader < 0) {
+			leader = fds[i];
+		}
+		slots[i] = members++;
+		opened = true;
+	}
+	if (!opened) {
+		fprintf(stderr, "Performance counters are not available: %s\n",
+			strerror(error));
+		return false;
+	}
+	owner = SDL_ThreadID();
+	return true;
+#else
+	fprintf(stderr, "Performance counters are only available on Linux\n");
+	return false;
+#endif
+}
+
+/**
+ * Returns true if the calling thread can read the counters
+ */
+bool perfOwned() {
+	return opened && SDL_ThreadID() == owner;
+}
+
+/**
+ * Reads the counters. Returns false if they are not open or belong to
+ * another thread.
+ */
+bool perfRead(PerfCounts *counts) {
+#ifdef __linux__
+	/* number of counters, times enabled and running, then the values */
+	__u64 group[3 + PERF_EVENTS];
+	ssize_t size = (ssize_t)((3 + members) * sizeof(__u64));
+	int i;
+
+	counts->valid = false;
+	if (!perfOwned() || read(leader, group, size) != size) {
+		return false;
+	}
+	for (i = 0; i < PERF_EVENTS; i++) {
+		counts->values[i] = fds[i] >= 0 ? (double)group[3 + slots[i]] : -1.;
+	}
+	counts->enabled = (double)group[1];
+	counts->running = (double)group[2];
+	counts->valid = true;
+	return true;
+#else
+	counts->valid = false;
+	return false;
+#endif
+}
+
+/**
+ * Turns a reading into the difference to an earlier one. If the counters
+ * only ran for part of the time in between, the difference is scaled up
+ * to the whole time; if they did not run at all, it is invalid.
+ */
+void perfSub(PerfCounts *to, PerfCounts *from) {
+	double enabled = to->enabled - from->enabled;
+	double running = to->running - from->running;
+	int i;
+
+	to->valid = to->valid && from->valid && running > 0.;
+	for (i = 0; i < PERF_EVENTS; i++) {
+		if (to->values[i] >= 0. && from->values[i] >= 0. && running > 0.) {
+			to->values[i] = (to->values[i] - from->values[i]) * enabled /
+				running;
+		} else {
+			to->values[i] = -1.;
+		}
+	}
+	to->enabled = enabled;
+	to->running = running;
+}
+
+/**
+ * Adds differences, e.g. of all chunks of a stage
+ */
+void perfAdd(PerfCounts *sum, PerfCounts *counts) {
+	int i;
+
+	if (!counts->valid) {
+		return;
+	}
+	if (!sum->valid) {
+		*sum = *counts;
+		return;
+	}
+	for (i = 0; i < PERF_EVENTS; i++) {
+		if (sum->values[i] >= 0. && counts->values[i] >= 0.) {
+			sum->values[i] += counts->values[i];
+		} else {
+			sum->values[i] = -1.;
+		}
+	}
+	sum->enabled += counts->enabled;
+	sum->running += counts->running;
+}
+
+/**
+ * Closes the counters
+ */
+void perfClose() {
+	int i;
+
+	for (i = 0; i < PERF_EVENTS; i++) {
+		if (fds[i] >= 0) {
+			close(fds[i]);
+			fds[i] = -1;
+		}
+	}
+	leader = -1;
+	members = 0;
+	opened = false;
+}
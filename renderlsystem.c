@@ -21,128 +21,134 @@
 
 #include <math.h>
 #include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "renderlsystem.h"
 #include "tools.h"
 #include "simplegfx.h"
 #include "lsystem.h"
+#include "geometry.h"
+#include "grid.h"
+#include "stats.h"
+#include "trace.h"
 
-#ifdef VRML
 /**
- * Print out the header for the VRML export
+ * Computes the screen coordinates x1, y1, x2, y2 of a segment
  */
-static void printVRMLHeader() {
-	int i;
-	static char *header[] = {
-		"#VRML V2.0 utf8",
-		"",
-		"PROTO Plant [",
-		"	exposedField SFNode plantmat Material {",
-		"		diffuseColor 0 0.5 0",
-		"	}",
-		"] {",
-		"	Transform {",
-		"		children [",
-		"			DEF branch Transform {",
-		"				children Shape {",
-		"					geometry Box {",
-		"						size 2 20 2",
-		"					}",
-		"					appearance Appearance {",
-		"						material IS plantmat",
-		"					}",
-		"				}",
-		"			}",
-		"			DEF TS1 TimeSensor {",
-		"				enabled TRUE",
-		"				loop TRUE",
-		"				cycleInterval 1.35",
-		"			}",
-		"			DEF OI1 OrientationInterpolator {",
-		"				key [ 0, 0.5, 1.0 ]",
-		"				keyValue [",
-		"					0 1 0 -0.5",
-		"					0 1 0 -1.0",
-		"					0 1 0 -0.6",
-		"				]",
-		"			}"};
-	for (i = 0; i < 32; i++) {
-		printf("%s\n", header[i]);
-	}
-}
+static void viewTransform(Segment *seg, View *view, int *c) {
+#ifdef __SSE2__
+	/* the four coordinates are next to each other in the segment */
+	__m128 p = _mm_mul_ps(_mm_loadu_ps(&seg->x1), _mm_set1_ps(view->zoom));
+	__m128i offset = _mm_set_epi32(view->offsetY, view->offsetX,
+		view->offsetY, view->offsetX);
+
+	_mm_storeu_si128((__m128i*)c, _mm_add_epi32(_mm_cvttps_epi32(p), offset));
+#else
+	c[0] = (int)(seg->x1 * view->zoom) + view->offsetX;
+	c[1] = (int)(seg->y1 * view->zoom) + view->offsetY;
+	c[2] = (int)(seg->x2 * view->zoom) + view->offsetX;
+	c[3] = (int)(seg->y2 * view->zoom) + view->offsetY;
 #endif
+}
 
 /**
- * Renders a L-System, starting at offsetX, offsetY.
+ * Prepares the interpretation of a L-System, drawn with the given view.
  * The L-System may contain the following characters:
  *  F - go one step to the current direction and draw line
  *  + - turn left
  *  - - turn right
  *  [ - push the current position and angle to the stack
  *  ] - pop the top stack element
+ * The drawn segments are recorded in geo, which is cleared first.
+ * The actual work is done in chunks by renderStep().
  */
-#define rnd ((double)randi(0, (int)(randomize * 100)/100.)/50.)
+void renderBegin(RenderJob *job, char *lsys, int len, double angle,
+		double randomize, View *view, Geometry *geo) {
 #ifdef VRML
-void renderLSystem(char *lsys, int len, double angle, double randomize,
-		int offsetX, int offsetY, bool exportVRML) {
-#else
-void renderLSystem(char *lsys, int len, double angle, double randomize,
-		int offsetX, int offsetY) {
-#endif
-	Uint32 green = sgCreateColor(0, 255, 0);
-	Uint32 white = sgCreateColor(255, 255, 255);
-	char *output;
-	int i;
-	int j = 0;
-#ifdef VRML
-	int openTransforms = 0;
-	int oldpath;
-	double rotation = 1.;
 	State state = {0.0, 0.0, -M_PI/2, 0, 0};
 #else
 	State state = {0.0, 0.0, -M_PI/2};
 #endif
-	int maxStackSize = 0;
-	double ang = deg2rad(angle);
-	State *tmp;
 
-	List list = cons(stateToObject(state), NULL);
+	job->lsys = lsys;
+	job->pos = 0;
+	job->length = strlen(lsys);
+	job->len = len;
+	job->angle = angle;
+	job->randomize = randomize;
+	job->view = *view;
+	job->state = state;
+	/* one allocation for the whole job, the stack only grows as deep as
+	 * the branches are nested */
+	job->stack = newn(State, RENDER_STACK);
+	job->depth = 0;
+	job->stackCapacity = RENDER_STACK;
+	job->maxStackSize = 0;
 #ifdef VRML
-	if (exportVRML) {
-		printVRMLHeader();
-	}
+	job->closes = 0;
 #endif
+	job->geo = geo;
+	geoClear(geo);
+	geo->angle = deg2rad(angle);
+}
 
-	output = newn(char, 70);
-	tmp = new(State);
+/**
+ * Interprets and draws the next count symbols of the L-System.
+ * Returns true when the whole L-System has been rendered.
+ */
+#define rnd ((double)randi(0, (int)(job->randomize * 100)/100.)/50.)
+bool renderStep(RenderJob *job, size_t count) {
+	Uint32 white = sgCreateColor(255, 255, 255);
+	char *lsys = job->lsys;
+	size_t end = job->pos + count;
+	size_t i;
+#ifdef VRML
+	int j = 0;
+#endif
+	double ang = job->geo->angle;
+	State state = job->state;
+	State tmp;
+	Segment seg;
+	int c[4];
+	int segments = job->geo->count;
+	double start = 0.;
+	double span = traceBegin();
+	PerfCounts counts;
+	bool counted = statCountBegin(&counts);
+	Stats before;
+	Stats after;
 
-	for (i = 0; i < strlen(lsys); i++) {
+	if (statEnabled()) {
+		statGet(&before);
+		start = statNow();
+	}
+	if (end > job->length || end < job->pos) {
+		end = job->length;
+	}
+	for (i = job->pos; i < end; i++) {
 		switch (lsys[i]) {
 			case 'F': /* go one step and draw */
-				tmp->x = state.x;
-				tmp->y = state.y;
-				tmp->ang = state.ang;
+				tmp = state;
+				state.x += cos(state.ang) * job->len;
+				state.y += sin(state.ang) * job->len;
+				seg.x1 = tmp.x;
+				seg.y1 = tmp.y;
+				seg.x2 = state.x;
+				seg.y2 = state.y;
+				seg.symbol = (int)i;
+				/* draw what is recorded, so that redrawing parts of
+				 * the plant from the geometry gives the same pixels */
+				viewTransform(&seg, &job->view, c);
+				sgLine(c[0], c[1], c[2], c[3], white);
 #ifdef VRML
-				tmp->rotation = state.rotation;
-#endif
-				state.x += cos(state.ang) * len;
-				state.y += sin(state.ang) * len;
-				sgLine((int)tmp->x + offsetX, (int)tmp->y + offsetY,
-					(int)state.x + offsetX, (int)state.y + offsetY, white);
-#ifdef VRML
-				if (exportVRML) {
-					rotation = state.rotation * ang;
-					printf(
-						"	Transform {\n"
-						"		translation 0 18 0\n"
-						"		rotation 0 0 1 %f\n"
-						"		center 0 -9 0\n"
-						"		children [\n"
-						"			USE branch\n", rotation);
-					openTransforms++;
-					state.path++;
-					state.rotation = 0;
-				}
+				seg.rotation = tmp.rotation;
+				seg.closes = job->closes;
+				job->closes = 0;
+				state.path++;
+				state.rotation = 0;
 #endif
+				geoAdd(job->geo, &seg);
 				break;
 			case '+': /* turn left */
 				state.ang -= ang + rnd;
@@ -159,27 +165,32 @@ void renderLSystem(char *lsys, int len, double angle, double randomize,
 #endif
 				break;
 			case '[': /* push state */
-				pushBack(list, stateToObject(state));
-				j = length(list);
-				if (j > maxStackSize) {
-					maxStackSize = j;
+				if (job->depth == job->stackCapacity) {
+					job->stackCapacity *= 2;
+					job->stack = (State*)memRealloc(job->stack,
+						job->stackCapacity * sizeof(State));
+					if (job->stack == NULL) {
+						fprintf(stderr, "realloc() failed");
+						exit(EXIT_FAILURE);
+					}
+				}
+				job->stack[job->depth++] = state;
+				/* the turtle itself counts as first element */
+				if (job->depth + 1 > job->maxStackSize) {
+					job->maxStackSize = job->depth + 1;
 				}
 				break;
 			case ']': /* pop state */
-#ifdef VRML
-				if (exportVRML) {
-					oldpath = state.path;
+				if (job->depth == 0) {
+					break;
 				}
+#ifdef VRML
+				j = state.path;
 #endif
-				state = *(State*)popBack(list);
+				state = job->stack[--job->depth];
 #ifdef VRML
-				if (exportVRML) {
-					for (j = oldpath - state.path; j > 0
-							&& openTransforms > 0; j--) {
-						openTransforms--;
-						printf("]}\n");
-					}
-				}
+				/* close the transforms of the finished branch */
+				job->closes += j - state.path;
 #endif
 				break;
 			default:
@@ -190,23 +201,172 @@ void renderLSystem(char *lsys, int len, double angle, double randomize,
 				break;
 		}
 	}
+	job->state = state;
+	job->pos = end;
+	if (statEnabled()) {
+		/* the lines are measured on their own */
+		statGet(&after);
+		statInterpreted(statNow() - start - (after.raster - before.raster),
+			(unsigned long)(job->geo->count - segments));
+	}
+	traceEnd("interpret", span);
+	if (counted) {
+		statCountEnd(STAT_RENDER, &counts);
+	}
 
-#ifdef VRML
-	if (exportVRML) {
-		for (i = openTransforms + 1; i > 0; i--) {
-			printf("]} ");
-		}
-		printf("	ROUTE TS1.fraction_changed TO OI1.set_fraction\n");
-		printf("	ROUTE OI1.value_changed TO branch.rotation\n");
-		printf("}\n");
-		fflush(stdout);
+	if (job->pos < job->length) {
+		return false;
 	}
+#ifdef VRML
+	job->geo->closes = job->closes;
 #endif
+	job->geo->maxStackSize = job->maxStackSize;
+	return true;
+}
+
+/**
+ * Frees the turtle stack of a finished or aborted job
+ */
+void renderEnd(RenderJob *job) {
+	memFree(job->stack);
+	job->stack = NULL;
+}
+
+/**
+ * Draws the status line of a rendered L-System
+ */
+void renderStatus(RenderJob *job) {
+	Uint32 green = sgCreateColor(0, 255, 0);
+	char output[70];
 
 	snprintf(output, 70, "Stack max: %d  Randomization: %1.2f  "
-		"Line length: %d  Angle: %3.2f", maxStackSize, randomize, len, angle);
-	sgDrawText(output, 10, 580, green);
-	free(output);
+		"Line length: %d  Angle: %3.2f", job->maxStackSize, job->randomize,
+		job->len, job->angle);
+	sgDrawText(output, 10, SG_TEXTLINE(0), green);
 }
 
+/**
+ * Renders a complete L-System with the given view and draws its status
+ * line. See renderBegin() for the supported characters.
+ */
+void renderLSystem(char *lsys, int len, double angle, double randomize,
+		View *view, Geometry *geo) {
+	RenderJob job;
+
+	renderBegin(&job, lsys, len, angle, randomize, view, geo);
+	renderStep(&job, job.length);
+	renderEnd(&job);
+	renderStatus(&job);
+}
 
+/**
+ * Draws recorded segments again with another view, without interpreting
+ * the L-System
+ */
+void renderView(Geometry *geo, View *view) {
+	Uint32 white = sgCreateColor(255, 255, 255);
+	double span = traceBegin();
+	PerfCounts counts;
+	bool counted = statCountBegin(&counts);
+	int c[4];
+	int i;
+
+	for (i = 0; i < geo->count; i++) {
+		viewTransform(&geo->segs[i], view, c);
+		sgLine(c[0], c[1], c[2], c[3], white);
+	}
+	traceEnd("raster view", span);
+	if (counted) {
+		statCountEnd(STAT_RASTER, &counts);
+	}
+}
+
+/**
+ * Redraws the recorded segments that touch a rectangle of the screen.
+ * The rectangle is expected to be cleared.
+ */
+void renderRegion(Grid *grid, View *view, SDL_Rect *rect) {
+	Uint32 white = sgCreateColor(255, 255, 255);
+	double span = traceBegin();
+	PerfCounts counts;
+	bool counted = statCountBegin(&counts);
+	int c[4];
+	int count;
+	int i;
+
+	/* one pixel of slack, as coordinates are truncated when drawn */
+	count = gridQuery(grid,
+		(rect->x - view->offsetX - 1) / view->zoom,
+		(rect->y - view->offsetY - 1) / view->zoom,
+		(rect->x + rect->w - view->offsetX + 1) / view->zoom,
+		(rect->y + rect->h - view->offsetY + 1) / view->zoom);
+	sgSetClip(rect);
+	for (i = 0; i < count; i++) {
+		viewTransform(&grid->geo->segs[grid->result[i]], view, c);
+		sgLine(c[0], c[1], c[2], c[3], white);
+	}
+	sgSetClip(NULL);
+	traceEnd("raster region", span);
+	if (counted) {
+		statCountEnd(STAT_RASTER, &counts);
+	}
+}
+
+/**
+ * Draws a single recorded segment in another color to highlight it
+ */
+void renderHighlight(Segment *seg, View *view, Uint32 color) {
+	int c[4];
+
+	viewTransform(seg, view, c);
+	sgLine(c[0], c[1], c[2], c[3], color);
+}
+
+/**
+ * Removes the highlight of a segment by drawing the plant around it
+ * again
+ */
+void renderUnhighlight(Grid *grid, View *view, Segment *seg) {
+	SDL_Rect rect;
+	int c[4];
+	int x1, y1, x2, y2;
+
+	viewTransform(seg, view, c);
+	x1 = c[0] < c[2] ? c[0] : c[2];
+	y1 = c[1] < c[3] ? c[1] : c[3];
+	x2 = c[0] < c[2] ? c[2] : c[0];
+	y2 = c[1] < c[3] ? c[3] : c[1];
+	/* the segment may be far off screen */
+	x1 = x1 < 0 ? 0 : x1;
+	y1 = y1 < 0 ? 0 : y1;
+	x2 = x2 >= sgWidth() ? sgWidth() - 1 : x2;
+	y2 = y2 >= sgHeight() ? sgHeight() - 1 : y2;
+	if (x2 < x1 || y2 < y1) {
+		return;
+	}
+	rect.x = x1;
+	rect.y = y1;
+	rect.w = x2 - x1 + 1;
+	rect.h = y2 - y1 + 1;
+	sgClearRect(rect.x, rect.y, rect.w, rect.h);
+	renderRegion(grid, view, &rect);
+}
+
+/**
+ * Moves a completely rendered L-System from one view to another with the
+ * same zoom. Instead of drawing the whole plant again, the screen is
+ * scrolled and only the uncovered parts are redrawn, so the cost
+ * depends on the distance rather than on the size of the plant.
+ * The texts have to be drawn again afterwards.
+ */
+void renderPan(Grid *grid, View *from, View *to) {
+	SDL_Rect damage[SG_MAXDAMAGE];
+	int count;
+	int i;
+
+	count = sgScroll(to->offsetX - from->offsetX,
+		to->offsetY - from->offsetY, damage);
+	for (i = 0; i < count; i++) {
+		renderRegion(grid, to, &damage[i]);
+	}
+}
@@ -22,20 +22,33 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
  */
 
+#include <string.h>
 #include "simplegfx.h"
 #include "unifont.h"
+#include "stats.h"
+#include "trace.h"
 
 /** The screen surface */
 static SDL_Surface *screen;
 /** The surface that acts as a color source */
 static SDL_Surface *colorSource;
+/** Flags of the video mode, kept for resizing */
+static Uint32 videoflags;
+/** Bits per pixel of the screen, 0 for the depth of the display */
+static int depth = 0;
+/** The part of the screen that lines are drawn to */
+static SDL_Rect canvas;
+/** Lines are only drawn inside this part of the canvas */
+static SDL_Rect clip;
+/** Texts on the screen, which must not be scrolled with the canvas */
+static SDL_Rect texts[SG_MAXTEXTS];
+/** Number of texts, more than SG_MAXTEXTS if some were not recorded */
+static int textCount = 0;
 
 /**
- * Create a new window and screen
+ * Create a new window and screen with the given resolution
  */
-int sgInit(bool fullscreen, char *title) {
-	Uint32 videoflags;
-
+int sgInit(bool fullscreen, char *title, int width, int height) {
 	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
 		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
 		return 1;
@@ -44,19 +57,72 @@ int sgInit(bool fullscreen, char *title) {
 	videoflags = SDL_SWSURFACE;
 	if (fullscreen)
 		videoflags |= SDL_FULLSCREEN;
+	else
+		videoflags |= SDL_RESIZABLE;
+
+	if (sgResize(width, height) != 0) {
+		return 1;
+	}
+	SDL_WM_SetCaption(title, NULL);
+
+	colorSource = sgCreateSurface(1, 1);
+	return 0;
+}
+
+/**
+ * Creates a screen that is never shown, e.g. to record videos on a
+ * machine without display. The screen always has 32 bits per pixel.
+ */
+int sgInitHeadless(char *title, int width, int height) {
+	SDL_putenv("SDL_VIDEODRIVER=dummy");
+	depth = 32;
+	return sgInit(false, title, width, height);
+}
+
+/**
+ * Changes the bits per pixel of the screen, 0 for the depth of the
+ * display. The screen is reallocated like in sgResize().
+ */
+int sgSetDepth(int bpp) {
+	depth = bpp;
+	return sgResize(screen->w, screen->h);
+}
 
-	screen = SDL_SetVideoMode(XRES, YRES, 0, videoflags);
+/**
+ * Changes the resolution, e.g. after the window was resized. The screen
+ * is reallocated, so everything has to be drawn again.
+ */
+int sgResize(int width, int height) {
+	screen = SDL_SetVideoMode(width, height, depth, videoflags);
 	if (screen == NULL) {
 		fprintf(stderr, "Couldn't set video mode: %s\n",
 			SDL_GetError());
 		return 1;
 	}
-	SDL_WM_SetCaption(title, NULL);
 
-	colorSource = sgCreateSurface(1, 1);
+	canvas.x = 0;
+	canvas.y = 0;
+	canvas.w = screen->w - 1;
+	canvas.h = screen->h - 1;
+	clip = canvas;
+	textCount = 0;
 	return 0;
 }
 
+/**
+ * Returns the width of the screen
+ */
+int sgWidth() {
+	return screen->w;
+}
+
+/**
+ * Returns the height of the screen
+ */
+int sgHeight() {
+	return screen->h;
+}
+
 /**
  * Creates a new surface with given dimensions
  */
@@ -136,6 +202,30 @@ void sgPutPixel(SDL_Surface *surface, int x, int y, Uint32 color) {
 	}
 }
 
+/**
+ * Get the color of a pixel on a surface
+ */
+Uint32 sgGetPixel(SDL_Surface *surface, int x, int y) {
+	int bpp = surface->format->BytesPerPixel;
+	Uint8 *p = (Uint8 *)surface->pixels + y * surface->pitch + x * bpp;
+
+	switch(bpp) {
+		case 1:
+			return *p;
+		case 2:
+			return *(Uint16 *)p;
+		case 3:
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+			return p[0] << 16 | p[1] << 8 | p[2];
+#else
+			return p[0] | p[1] << 8 | p[2] << 16;
+#endif
+		case 4:
+			return *(Uint32 *)p;
+	}
+	return 0;
+}
+
 /**
  * Draw a single character onto a surface using the unifont.
  * The character pointer should be a pointer to the unifont character array.
@@ -168,16 +258,18 @@ static void sgDrawCharacter(SDL_Surface *surface, int x, int y, Uint32 color,
  * Draw a complete UTF-8 string onto a given surface. This also works
  * with static strings (strings that are contained in the sourcecode) as
  * long as the corresponding source file is UTF-8 encoded.
- * Example: sgDrawUTF8Text(surface, 0, 0, color, "░░▒▒▓▓██");
+ * The area covered by the text is stored in extent.
+ * Example: sgDrawUTF8Text(surface, 0, 0, color, "░░▒▒▓▓██", &extent);
  */
 static void sgDrawUTF8Text(SDL_Surface *surface, int x, int y,
-	Uint32 color, char *ch) {
+	Uint32 color, char *ch, SDL_Rect *extent) {
 
 	int chlen = strlen(ch);
 	int i = 0, k;
 	int c;					/* unicode codepoint */
 	int followbytes = 0;	/* number of following bytes */
 	int drawx = x;
+	int maxx = x;
 	int line = 0;
 	unsigned char byte;
 	unsigned char chati;
@@ -246,9 +338,17 @@ static void sgDrawUTF8Text(SDL_Surface *surface, int x, int y,
 		} else {
 			sgDrawCharacter(surface, drawx, y + (line * 15), color, unifont[c]);
 			drawx += strlen(unifont[c]) / 4;
+			if (drawx > maxx) {
+				maxx = drawx;
+			}
 		}
 		i++;
 	}
+
+	extent->x = x;
+	extent->y = y;
+	extent->w = maxx - x + 1;
+	extent->h = line * 15 + 16;
 } 
 
 /**
@@ -256,7 +356,20 @@ static void sgDrawUTF8Text(SDL_Surface *surface, int x, int y,
  * See descriptions of functions sgDrawCharacter and sgDrawUTF8Text above.
  */
 void sgDrawText(char *text, int x, int y, Uint32 color) {
-	sgDrawUTF8Text(screen, x, y, color, text);
+	SDL_Rect extent;
+	double start = 0.;
+
+	if (statEnabled()) {
+		start = statNow();
+	}
+	sgDrawUTF8Text(screen, x, y, color, text, &extent);
+	if (statEnabled()) {
+		statTextDrawn(statNow() - start);
+	}
+	if (textCount < SG_MAXTEXTS) {
+		texts[textCount] = extent;
+	}
+	textCount++;
 }
 
 /**
@@ -279,22 +392,184 @@ void sgDrawImage(SDL_Surface *img, int x, int y) {
  */
 void sgClearScreen() {
 	SDL_FillRect(screen, 0, 0);
+	textCount = 0;
 }
 
 /**
  * Updates the screen
  */
 void sgUpdateScreen() {
+	double span = traceBegin();
+
 	SDL_UpdateRect(screen, 0, 0, 0, 0);
+	traceEnd("present", span);
 }
 
 /**
- * Draws a line using Bresenham's line algorithm
+ * Clears a rectangular part of the screen
+ */
+void sgClearRect(int x, int y, int w, int h) {
+	SDL_Rect rect;
+	int i;
+
+	rect.x = x;
+	rect.y = y;
+	rect.w = w;
+	rect.h = h;
+	SDL_FillRect(screen, &rect, 0);
+
+	/* forget the texts that were cleared */
+	for (i = 0; i < textCount && textCount <= SG_MAXTEXTS; ) {
+		if (texts[i].x >= x && texts[i].y >= y &&
+				texts[i].x + texts[i].w <= x + w &&
+				texts[i].y + texts[i].h <= y + h) {
+			texts[i] = texts[--textCount];
+		} else {
+			i++;
+		}
+	}
+}
+
+/**
+ * Updates only a rectangular part of the screen
+ */
+void sgUpdateRect(int x, int y, int w, int h) {
+	SDL_UpdateRect(screen, x, y, w, h);
+}
+
+/**
+ * Shrinks rect to the part that lies within bounds.
+ * Returns false if nothing is left.
+ */
+static bool sgIntersect(SDL_Rect *rect, SDL_Rect *bounds) {
+	int x1 = rect->x > bounds->x ? rect->x : bounds->x;
+	int y1 = rect->y > bounds->y ? rect->y : bounds->y;
+	int x2 = rect->x + rect->w < bounds->x + bounds->w ?
+		rect->x + rect->w : bounds->x + bounds->w;
+	int y2 = rect->y + rect->h < bounds->y + bounds->h ?
+		rect->y + rect->h : bounds->y + bounds->h;
+
+	if (x2 <= x1 || y2 <= y1) {
+		return false;
+	}
+	rect->x = x1;
+	rect->y = y1;
+	rect->w = x2 - x1;
+	rect->h = y2 - y1;
+	return true;
+}
+
+/**
+ * Restricts the drawing of lines to a rectangle, or to the whole canvas
+ * again if rect is NULL
+ */
+void sgSetClip(SDL_Rect *rect) {
+	SDL_Rect result = canvas;
+
+	if (rect != NULL && !sgIntersect(&result, rect)) {
+		result.w = 0;
+		result.h = 0;
+	}
+	clip = result;
+}
+
+/**
+ * Adds the on-screen part of a rectangle to a list of damaged areas
+ */
+static void sgAddDamage(SDL_Rect *damage, int *count, int x, int y,
+		int w, int h) {
+	SDL_Rect all;
+	SDL_Rect rect;
+
+	all.x = 0;
+	all.y = 0;
+	all.w = screen->w;
+	all.h = screen->h;
+
+	rect.x = x;
+	rect.y = y;
+	rect.w = w;
+	rect.h = h;
+	if (sgIntersect(&rect, &all)) {
+		damage[(*count)++] = rect;
+	}
+}
+
+/**
+ * Moves the lines on the canvas by dx, dy pixels. Texts stay where they
+ * are. The areas that have to be redrawn, i.e. the uncovered strips and
+ * the places of the texts, are cleared and stored in damage, which must
+ * have room for SG_MAXDAMAGE rectangles. Returns their number.
+ */
+int sgScroll(int dx, int dy, SDL_Rect *damage) {
+	Uint8 *pixels = (Uint8*)screen->pixels;
+	int bpp = screen->format->BytesPerPixel;
+	int w = canvas.w - abs(dx);
+	int h = canvas.h - abs(dy);
+	int srcX = canvas.x + (dx < 0 ? -dx : 0);
+	int dstX = canvas.x + (dx > 0 ? dx : 0);
+	int count = 0;
+	int i, y, first, last, step;
+
+	/* nothing is left to reuse, or we lost track of the texts */
+	if (w <= 0 || h <= 0 || textCount > SG_MAXTEXTS) {
+		textCount = 0;
+		SDL_FillRect(screen, 0, 0);
+		damage[0] = canvas;
+		return 1;
+	}
+
+	/* move the rows, starting with the one that is overwritten first */
+	first = dy > 0 ? h - 1 : 0;
+	last = dy > 0 ? -1 : h;
+	step = dy > 0 ? -1 : 1;
+	for (y = first; y != last; y += step) {
+		memmove(pixels + (canvas.y + y + (dy > 0 ? dy : 0)) * screen->pitch +
+			dstX * bpp,
+			pixels + (canvas.y + y + (dy < 0 ? -dy : 0)) * screen->pitch +
+			srcX * bpp, w * bpp);
+	}
+
+	/* uncovered columns and rows */
+	if (dx != 0) {
+		sgAddDamage(damage, &count, dx > 0 ? canvas.x : canvas.x + w,
+			canvas.y, abs(dx), canvas.h);
+	}
+	if (dy != 0) {
+		sgAddDamage(damage, &count, canvas.x,
+			dy > 0 ? canvas.y : canvas.y + h, canvas.w, abs(dy));
+	}
+	/* the texts where they were moved to and where they are drawn again */
+	for (i = 0; i < textCount; i++) {
+		sgAddDamage(damage, &count, texts[i].x + dx, texts[i].y + dy,
+			texts[i].w, texts[i].h);
+		sgAddDamage(damage, &count, texts[i].x, texts[i].y,
+			texts[i].w, texts[i].h);
+	}
+	textCount = 0;
+
+	for (i = 0; i < count; i++) {
+		SDL_FillRect(screen, &damage[i], 0);
+	}
+	return count;
+}
+
+/**
+ * Draws a line using Bresenham's line algorithm. Only the part inside
+ * the clipping rectangle is drawn. Returns the number of pixels written.
  */
 #define in(x,b1,b2) ((x>=b1) && (x<b2))
-void sgLine(int x1, int y1, int x2, int y2, Uint32 color) {
+static int drawLine(int x1, int y1, int x2, int y2, Uint32 color) {
 	bool steep = (abs(y2 - y1) > abs(x2 - x1));
 	int x, y, v, dx, dy, da, ystep;
+	int pixels = 0;
+
+	/* skip lines that are entirely on one side of the clipping area */
+	if ((x1 < clip.x && x2 < clip.x) || (y1 < clip.y && y2 < clip.y) ||
+			(x1 >= clip.x + clip.w && x2 >= clip.x + clip.w) ||
+			(y1 >= clip.y + clip.h && y2 >= clip.y + clip.h)) {
+		return 0;
+	}
 
 	if(steep) {
 		swap(&x1, &y1);
@@ -315,11 +590,17 @@ void sgLine(int x1, int y1, int x2, int y2, Uint32 color) {
 
 	for(x = x1; x <= x2; x++) {
 		if(steep) {
-			if (in(y, 0, XRES-1) && in(x, 0, YRES-1))
+			if (in(y, clip.x, clip.x + clip.w) &&
+					in(x, clip.y, clip.y + clip.h)) {
 				sgPutPixel(screen, y, x, color);
+				pixels++;
+			}
 		} else {
-			if (in(x, 0, XRES-1) && in(y, 0, YRES-1))
+			if (in(x, clip.x, clip.x + clip.w) &&
+					in(y, clip.y, clip.y + clip.h)) {
 				sgPutPixel(screen, x, y, color);
+				pixels++;
+			}
 		}
 
 		v += da;
@@ -328,5 +609,29 @@ void sgLine(int x1, int y1, int x2, int y2, Uint32 color) {
 			v -= dx;
 		}
 	}
+	return pixels;
+}
+
+/**
+ * Draws a line, see drawLine()
+ */
+void sgLine(int x1, int y1, int x2, int y2, Uint32 color) {
+	static unsigned int lines = 0;
+	double start;
+	int pixels;
+
+	if (!statEnabled()) {
+		drawLine(x1, y1, x2, y2, color);
+		return;
+	}
+	if (++lines % STAT_SAMPLE != 0) {
+		pixels = drawLine(x1, y1, x2, y2, color);
+		statRasterized(0., (unsigned long)pixels);
+		return;
+	}
+	/* the sampled line stands for the ones that were not timed */
+	start = statNow();
+	pixels = drawLine(x1, y1, x2, y2, color);
+	statRasterized((statNow() - start) * STAT_SAMPLE, (unsigned long)pixels);
 }
 
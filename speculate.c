@@ -0,0 +1,120 @@
+/* speculate.c
+ * Derive the next iteration in the background while the current one is shown
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include "SDL.h"
+#include "speculate.h"
+#include "lsystem.h"
+#include "trace.h"
+#include "tools.h"
+
+/*
+ * While the user looks at iteration N, a worker thread derives
+ * iteration N+1. When the next iteration is requested, the result is
+ * taken over (waiting for the worker if it is not finished yet), so
+ * the expensive derivation overlaps with the time the user spends
+ * looking at the plant.
+ * Speculation is keyed by the string and the rule it was started for:
+ * asking for anything else cancels it.
+ */
+
+/** The worker thread, NULL if no speculation is running or finished */
+static SDL_Thread *thread;
+/** Input of the speculation */
+static char *specLsys;
+static char *specFTo;
+/** Result of the speculation, NULL if it was canceled or over budget */
+static char *result;
+static volatile bool cancel;
+static unsigned long budget = SPEC_BUDGET;
+
+/**
+ * Thread function: derives the next iteration unless it would exceed
+ * the memory budget
+ */
+static int specThread(void *unused) {
+	traceThreadName("speculate");
+	if (lSysLength(specLsys, specFTo) + 1 > budget) {
+		result = NULL;
+		return 1;
+	}
+	result = lSysDerive(specLsys, specFTo, &cancel);
+	return 0;
+}
+
+/**
+ * Sets the maximum size of a speculatively derived string in bytes
+ */
+void specSetBudget(unsigned long bytes) {
+	budget = bytes;
+}
+
+/**
+ * Cancels the running speculation and discards its result
+ */
+void specCancel() {
+	if (thread == NULL) {
+		return;
+	}
+	cancel = true;
+	SDL_WaitThread(thread, NULL);
+	thread = NULL;
+	if (result != NULL && result != specLsys) {
+		memFree(result);
+	}
+	result = NULL;
+}
+
+/**
+ * Starts deriving the iteration that follows lsys in the background
+ */
+void specStart(char *lsys, char *fTo) {
+	if (thread != NULL && specLsys == lsys && specFTo == fTo) {
+		return;
+	}
+	specCancel();
+	specLsys = lsys;
+	specFTo = fTo;
+	result = NULL;
+	cancel = false;
+	thread = SDL_CreateThread(specThread, NULL);
+}
+
+/**
+ * Returns the iteration that follows lsys, like lSystem(). If it was
+ * speculatively derived, the result is taken over, otherwise it is
+ * derived now.
+ */
+char *specTake(char *lsys, char *fTo) {
+	char *next = NULL;
+
+	if (thread != NULL && specLsys == lsys && specFTo == fTo) {
+		SDL_WaitThread(thread, NULL);
+		thread = NULL;
+		next = result;
+		result = NULL;
+	} else {
+		specCancel();
+	}
+	if (next == NULL) {
+		next = lSystem(lsys, fTo);
+	}
+	return next;
+}
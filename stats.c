@@ -0,0 +1,194 @@
+/* stats.c
+ * Timing of the drawing stages
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include "SDL.h"
+#include "mem.h"
+#include "stats.h"
+
+/** Measurements are only taken while the overlay is shown */
+static bool enabled = false;
+/** The stages of the current frame */
+static Stats current;
+/** Derivations run on other threads, too */
+static SDL_mutex *lock = NULL;
+/** Allocations before the current frame */
+static unsigned long frameAllocs = 0;
+
+/**
+ * Prepares recording derivations from other threads; without it, only
+ * the stages on the main thread are measured
+ */
+void statInit() {
+	if (lock == NULL) {
+		lock = SDL_CreateMutex();
+	}
+}
+
+/**
+ * Starts or stops taking measurements
+ */
+void statEnable(bool enable) {
+	enabled = enable;
+}
+
+/**
+ * Returns true if measurements should be taken
+ */
+bool statEnabled() {
+	return enabled;
+}
+
+/**
+ * Returns the time of a monotonic clock in seconds
+ */
+double statNow() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Starts a new frame. The last derivation is kept until there is a new
+ * one.
+ */
+void statReset() {
+	MemStats mem;
+
+	memGetStats(&mem);
+	frameAllocs = mem.calls;
+	current.interpret = 0.;
+	current.segments = 0;
+	current.raster = 0.;
+	current.pixels = 0;
+	current.text = 0.;
+	current.counts[STAT_RENDER].valid = false;
+	current.counts[STAT_RASTER].valid = false;
+}
+
+/**
+ * Records a finished derivation
+ */
+void statDerived(double seconds, unsigned long symbols) {
+	if (lock == NULL) {
+		return;
+	}
+	SDL_mutexP(lock);
+	current.derive = seconds;
+	current.symbols = symbols;
+	SDL_mutexV(lock);
+}
+
+/**
+ * Adds time spent moving the turtle
+ */
+void statInterpreted(double seconds, unsigned long segments) {
+	current.interpret += seconds;
+	current.segments += segments;
+}
+
+/**
+ * Adds time spent drawing lines
+ */
+void statRasterized(double seconds, unsigned long pixels) {
+	current.raster += seconds;
+	current.pixels += pixels;
+}
+
+/**
+ * Adds time spent drawing text
+ */
+void statTextDrawn(double seconds) {
+	current.text += seconds;
+}
+
+/**
+ * Reads the hardware counters at the start of a stage. Returns false if
+ * they are not counted, i.e. on other threads than the one that opened
+ * them or while no measurements are taken.
+ */
+bool statCountBegin(PerfCounts *before) {
+	before->valid = false;
+	return perfOwned() && enabled && perfRead(before);
+}
+
+/**
+ * Records the hardware counters of a stage since statCountBegin(). A
+ * derivation without counters, e.g. on another thread, clears the
+ * counters of the previous one.
+ */
+void statCountEnd(int stage, PerfCounts *before) {
+	PerfCounts after;
+
+	after.valid = false;
+	if (before != NULL && before->valid && perfRead(&after)) {
+		perfSub(&after, before);
+	}
+	if (stage == STAT_DERIVE) {
+		if (lock == NULL) {
+			return;
+		}
+		SDL_mutexP(lock);
+		current.counts[stage] = after;
+		SDL_mutexV(lock);
+	} else {
+		perfAdd(&current.counts[stage], &after);
+	}
+}
+
+/**
+ * Copies the measurements of the current frame
+ */
+void statGet(Stats *stats) {
+	MemStats mem;
+
+	if (lock != NULL) {
+		SDL_mutexP(lock);
+	}
+	*stats = current;
+	if (lock != NULL) {
+		SDL_mutexV(lock);
+	}
+	memGetStats(&mem);
+	stats->allocs = mem.calls - frameAllocs;
+}
+
+/**
+ * Returns the resident memory of the process in bytes, or 0 where
+ * /proc is not available
+ */
+unsigned long statRSS() {
+	FILE *f = fopen("/proc/self/statm", "r");
+	unsigned long size = 0;
+	unsigned long resident = 0;
+
+	if (f == NULL) {
+		return 0;
+	}
+	if (fscanf(f, "%lu %lu", &size, &resident) != 2) {
+		resident = 0;
+	}
+	fclose(f);
+	return resident * sysconf(_SC_PAGESIZE);
+}
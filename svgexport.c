@@ -0,0 +1,234 @@
+/* svgexport.c
+ * Streaming SVG export of the segment buffer
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <math.h>
+#include "svgexport.h"
+#include "export.h"
+#include "tools.h"
+
+/*
+ * Consecutive segments where one starts at the end of the previous one
+ * are joined into a single <path> with relative coordinates. Points
+ * are streamed to the writer as they come, so only the current point
+ * of the path is kept in memory.
+ * With a tolerance > 0, paths are simplified on the fly: points are
+ * dropped as long as they lie within a strip of the given width (in
+ * pixels) around the line from the last written point through the
+ * first dropped one (Reumann-Witkam).
+ */
+
+/** State of the path that is currently written */
+typedef struct {
+	Writer *w;
+	double tolerance;
+	long x;			/* last written point in 1/100 pixels */
+	long y;
+	double ax;		/* anchor of the simplification strip */
+	double ay;
+	double dx;		/* direction of the strip, zero if undefined */
+	double dy;
+	double px;		/* pending point, not written yet */
+	double py;
+	bool pending;
+} SVGPath;
+
+/**
+ * Writes a coordinate given in 1/100 pixels with up to two decimals
+ */
+static void writeCoord(Writer *w, long c) {
+	char frac[4];
+	int n = 0;
+
+	if (c < 0) {
+		wrPuts(w, "-");
+		c = -c;
+	}
+	wrInt(w, c / 100);
+	if (c % 100 != 0) {
+		frac[n++] = '.';
+		frac[n++] = '0' + (char)(c % 100 / 10);
+		if (c % 10 != 0) {
+			frac[n++] = '0' + (char)(c % 10);
+		}
+		wrWrite(w, frac, n);
+	}
+}
+
+/**
+ * Writes a point relative to the last one. The position is rounded
+ * before taking the difference, so rounding errors do not accumulate.
+ */
+static void writePoint(SVGPath *path, double x, double y) {
+	long nx = (long)floor(x * 100 + 0.5);
+	long ny = (long)floor(y * 100 + 0.5);
+
+	wrPuts(path->w, " ");
+	writeCoord(path->w, nx - path->x);
+	wrPuts(path->w, " ");
+	writeCoord(path->w, ny - path->y);
+	path->x = nx;
+	path->y = ny;
+}
+
+/**
+ * Sets the direction of the simplification strip from the anchor to
+ * the pending point
+ */
+static void setDirection(SVGPath *path) {
+	double l;
+
+	path->dx = path->px - path->ax;
+	path->dy = path->py - path->ay;
+	l = sqrt(path->dx * path->dx + path->dy * path->dy);
+	if (l > 0) {
+		path->dx /= l;
+		path->dy /= l;
+	}
+}
+
+/**
+ * Starts a new path at the given point
+ */
+static void beginPath(SVGPath *path, double x, double y) {
+	path->x = (long)floor(x * 100 + 0.5);
+	path->y = (long)floor(y * 100 + 0.5);
+	wrPuts(path->w, "<path d=\"M");
+	writeCoord(path->w, path->x);
+	wrPuts(path->w, " ");
+	writeCoord(path->w, path->y);
+	wrPuts(path->w, "l");
+	path->ax = x;
+	path->ay = y;
+	path->pending = false;
+}
+
+/**
+ * Adds a point to the current path
+ */
+static void addPoint(SVGPath *path, double x, double y) {
+	double ex = x - path->ax;
+	double ey = y - path->ay;
+
+	if (path->tolerance <= 0) {
+		writePoint(path, x, y);
+		return;
+	}
+	/* the point can be dropped if it lies within the strip and does not
+	 * turn back behind the pending point */
+	if (path->pending && ((path->dx == 0 && path->dy == 0) ||
+			(fabs(path->dx * ey - path->dy * ex) <= path->tolerance &&
+			path->dx * ex + path->dy * ey >= path->dx * (path->px - path->ax)
+				+ path->dy * (path->py - path->ay)))) {
+		path->px = x;
+		path->py = y;
+		if (path->dx == 0 && path->dy == 0) {
+			setDirection(path);
+		}
+		return;
+	}
+	/* the point leaves the strip: keep the last point inside */
+	if (path->pending) {
+		writePoint(path, path->px, path->py);
+		path->ax = path->px;
+		path->ay = path->py;
+	}
+	path->px = x;
+	path->py = y;
+	path->pending = true;
+	setDirection(path);
+}
+
+/**
+ * Finishes the current path
+ */
+static void endPath(SVGPath *path) {
+	if (path->pending) {
+		writePoint(path, path->px, path->py);
+	}
+	wrPuts(path->w, "\"/>\n");
+}
+
+/**
+ * Exports the segments as SVG
+ */
+void writeSVG(Writer *w, Geometry *geo, double tolerance) {
+	SVGPath path;
+	Segment *seg;
+	double minX = 0., minY = 0., maxX = 0., maxY = 0.;
+	int i;
+
+	for (i = 0; i < geo->count; i++) {
+		seg = &geo->segs[i];
+		if (i == 0) {
+			minX = maxX = seg->x1;
+			minY = maxY = seg->y1;
+		}
+		minX = seg->x1 < minX ? seg->x1 : minX;
+		minX = seg->x2 < minX ? seg->x2 : minX;
+		minY = seg->y1 < minY ? seg->y1 : minY;
+		minY = seg->y2 < minY ? seg->y2 : minY;
+		maxX = seg->x1 > maxX ? seg->x1 : maxX;
+		maxX = seg->x2 > maxX ? seg->x2 : maxX;
+		maxY = seg->y1 > maxY ? seg->y1 : maxY;
+		maxY = seg->y2 > maxY ? seg->y2 : maxY;
+	}
+	/* one pixel margin for the stroke */
+	minX = floor(minX) - 1;
+	minY = floor(minY) - 1;
+	maxX = ceil(maxX) + 1;
+	maxY = ceil(maxY) + 1;
+
+	wrPuts(w, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"");
+	wrInt(w, (long)minX);
+	wrPuts(w, " ");
+	wrInt(w, (long)minY);
+	wrPuts(w, " ");
+	wrInt(w, (long)(maxX - minX));
+	wrPuts(w, " ");
+	wrInt(w, (long)(maxY - minY));
+	wrPuts(w, "\" width=\"");
+	wrInt(w, (long)(maxX - minX));
+	wrPuts(w, "\" height=\"");
+	wrInt(w, (long)(maxY - minY));
+	wrPuts(w, "\">\n"
+		"<g fill=\"none\" stroke=\"black\" stroke-width=\"1\" "
+		"stroke-linecap=\"round\" stroke-linejoin=\"round\">\n");
+
+	path.w = w;
+	path.tolerance = tolerance;
+	for (i = 0; i < geo->count; i++) {
+		seg = &geo->segs[i];
+		if (i == 0 || seg->x1 != geo->segs[i - 1].x2
+				|| seg->y1 != geo->segs[i - 1].y2) {
+			if (i > 0) {
+				endPath(&path);
+			}
+			beginPath(&path, seg->x1, seg->y1);
+		}
+		addPoint(&path, seg->x2, seg->y2);
+		exportProgress(w, i, geo->count);
+	}
+	if (geo->count > 0) {
+		endPath(&path);
+	}
+	wrPuts(w, "</g>\n</svg>\n");
+}
@@ -0,0 +1,567 @@
+/* difftest.c
+ * Golden-image and differential test of the derivation and drawing
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "lsystem.h"
+#include "renderlsystem.h"
+#include "simplegfx.h"
+#include "animate.h"
+#include "speculate.h"
+#include "stats.h"
+#include "grid.h"
+#include "history.h"
+#include "patterns.h"
+#include "tools.h"
+
+/* Size of the hidden screen */
+#define DT_XRES 800
+#define DT_YRES 600
+/* Iterations are tested until the string gets longer than this */
+#define DT_MAXSYMBOLS (1ul << 19)
+/* Chunk size of the progressive rendering, small to cross many chunks */
+#define DT_CHUNK 7
+/* Maximum number of golden references */
+#define DT_MAXGOLDEN 256
+/* Maximum number of patterns read from the README */
+#define DT_MAXPATTERNS 32
+/* Memory budget of the history check, and the size of its strings */
+#define DT_HISTBUDGET 1000ul
+#define DT_HISTSTRING 500
+
+/**
+ * Checksums of one iteration of a pattern
+ */
+typedef struct {
+	char rule[100];
+	double angle;
+	int factor;
+	int iteration;
+	unsigned long symbols;
+	unsigned long string;
+	unsigned long segments;
+	unsigned long framebuffer;
+} Golden;
+
+/**
+ * A way of deriving the next iteration
+ */
+typedef struct {
+	char *name;
+	char *(*derive)(char *lsys, char *fTo);
+} Deriver;
+
+/**
+ * A way of drawing an iteration. The reference geometry is complete;
+ * engines that record geometry themselves do so into geo.
+ */
+typedef struct {
+	char *name;
+	bool records;
+	void (*draw)(char *lsys, int len, double angle, Geometry *ref,
+		Geometry *geo);
+} Drawer;
+
+/* Patterns that are tested in addition to those of the README, because
+ * they once broke an engine */
+static Pattern regressions[] = {
+	/* brackets that do not match are ignored by the turtle */
+	{"F]F[+F]-F", 30., 8}
+};
+
+/** The view all plants are drawn with */
+static View view = {1.f, DT_XRES / 2, DT_YRES};
+
+/**
+ * Adds bytes to a 32 bit FNV-1a hash
+ */
+static Uint32 hash(Uint32 h, const void *data, size_t n) {
+	const unsigned char *p = (const unsigned char*)data;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		h = (h ^ p[i]) * 16777619u;
+	}
+	return h;
+}
+
+#define HASH_START 2166136261u
+
+/**
+ * Hashes all recorded segments field by field
+ */
+static Uint32 hashGeometry(Geometry *geo) {
+	Uint32 h = HASH_START;
+	int i;
+
+	for (i = 0; i < geo->count; i++) {
+		h = hash(h, &geo->segs[i].x1, sizeof(float));
+		h = hash(h, &geo->segs[i].y1, sizeof(float));
+		h = hash(h, &geo->segs[i].x2, sizeof(float));
+		h = hash(h, &geo->segs[i].y2, sizeof(float));
+		h = hash(h, &geo->segs[i].symbol, sizeof(int));
+#ifdef VRML
+		h = hash(h, &geo->segs[i].rotation, sizeof(int));
+		h = hash(h, &geo->segs[i].closes, sizeof(int));
+#endif
+	}
+	return h;
+}
+
+/**
+ * Hashes the visible pixels of the screen
+ */
+static Uint32 hashScreen() {
+	SDL_Surface *screen = SDL_GetVideoSurface();
+	Uint32 h = HASH_START;
+	int y;
+
+	SDL_LockSurface(screen);
+	for (y = 0; y < screen->h; y++) {
+		h = hash(h, (Uint8*)screen->pixels + y * screen->pitch,
+			screen->w * screen->format->BytesPerPixel);
+	}
+	SDL_UnlockSurface(screen);
+	return h;
+}
+
+/**
+ * Derives with lSystem(), this is the reference
+ */
+static char *deriveSerial(char *lsys, char *fTo) {
+	return lSystem(lsys, fTo);
+}
+
+/**
+ * Derives with the cancelable derivation of the background threads
+ */
+static char *deriveCancelable(char *lsys, char *fTo) {
+	bool cancel = false;
+
+	return lSysDerive(lsys, fTo, &cancel);
+}
+
+/**
+ * Derives on the speculation thread
+ */
+static char *deriveSpeculative(char *lsys, char *fTo) {
+	specStart(lsys, fTo);
+	return specTake(lsys, fTo);
+}
+
+/**
+ * Interprets and draws the whole string at once, this is the reference
+ */
+static void drawOnce(char *lsys, int len, double angle, Geometry *ref,
+		Geometry *geo) {
+	RenderJob job;
+
+	sgClearScreen();
+	renderBegin(&job, lsys, len, angle, 0., &view, geo);
+	renderStep(&job, job.length);
+	renderEnd(&job);
+}
+
+/**
+ * Interprets and draws the string in small chunks, like the progressive
+ * rendering of the window
+ */
+static void drawChunked(char *lsys, int len, double angle, Geometry *ref,
+		Geometry *geo) {
+	RenderJob job;
+
+	sgClearScreen();
+	renderBegin(&job, lsys, len, angle, 0., &view, geo);
+	while (!renderStep(&job, DT_CHUNK)) {
+	}
+	renderEnd(&job);
+}
+
+/**
+ * Draws the reference while the timing overlay takes measurements
+ */
+static void drawMeasured(char *lsys, int len, double angle, Geometry *ref,
+		Geometry *geo) {
+	statEnable(true);
+	drawOnce(lsys, len, angle, ref, geo);
+	statEnable(false);
+}
+
+/**
+ * Draws the recorded segments, like zooming does
+ */
+static void drawView(char *lsys, int len, double angle, Geometry *ref,
+		Geometry *geo) {
+	sgClearScreen();
+	renderView(ref, &view);
+}
+
+/**
+ * Draws the whole screen from the spatial index
+ */
+static void drawRegion(char *lsys, int len, double angle, Geometry *ref,
+		Geometry *geo) {
+	Grid *grid = gridNew(ref);
+	SDL_Rect rect;
+
+	rect.x = 0;
+	rect.y = 0;
+	rect.w = sgWidth();
+	rect.h = sgHeight();
+	sgClearScreen();
+	renderRegion(grid, &view, &rect);
+	gridFree(grid);
+}
+
+/**
+ * Draws the plant moved away and pans back to it, which only redraws
+ * the uncovered parts of the screen
+ */
+static void drawPanned(char *lsys, int len, double angle, Geometry *ref,
+		Geometry *geo) {
+	Grid *grid = gridNew(ref);
+	View moved = view;
+
+	moved.offsetX += 37;
+	moved.offsetY -= 23;
+	sgClearScreen();
+	renderView(ref, &moved);
+	renderPan(grid, &moved, &view);
+	gridFree(grid);
+}
+
+/**
+ * Plays the growth animation to its end
+ */
+static void drawGrown(char *lsys, int len, double angle, Geometry *ref,
+		Geometry *geo) {
+	Animation anim;
+
+	animStart(&anim, ref, lsys, &view, ANIM_DEPTH);
+	animFrameAt(&anim, ANIM_DURATION);
+	animEnd(&anim);
+}
+
+/**
+ * Replays the drawing order to its end
+ */
+static void drawReplayed(char *lsys, int len, double angle, Geometry *ref,
+		Geometry *geo) {
+	Animation anim;
+
+	animStart(&anim, ref, lsys, &view, ANIM_DRAWING);
+	animFrameAt(&anim, ANIM_DURATION);
+	animEnd(&anim);
+}
+
+/* New engines are added here and are then checked against the
+ * reference, which is the first entry of each table */
+static Deriver derivers[] = {
+	{"serial", deriveSerial},
+	{"cancelable", deriveCancelable},
+	{"speculative", deriveSpeculative}
+};
+
+static Drawer drawers[] = {
+	{"once", true, drawOnce},
+	{"chunked", true, drawChunked},
+	{"measured", true, drawMeasured},
+	{"view", false, drawView},
+	{"region", false, drawRegion},
+	{"panned", false, drawPanned},
+	{"grown", false, drawGrown},
+	{"replayed", false, drawReplayed}
+};
+
+#define COUNT(a) ((int)(sizeof(a) / sizeof(a[0])))
+
+/** Number of checks and failures */
+static int checks = 0;
+static int failures = 0;
+
+/**
+ * Compares a checksum and reports a divergence
+ */
+static void check(Golden *g, char *what, char *engine, unsigned long expected,
+		unsigned long actual) {
+	checks++;
+	if (expected != actual) {
+		failures++;
+		printf("FAIL %s -a %g -x %d, iteration %d: %s of %s is %08lx, "
+			"expected %08lx\n", g->rule, g->angle, g->factor, g->iteration,
+			what, engine, actual, expected);
+	}
+}
+
+/**
+ * Reads the golden references. Returns the number of entries, or -1 if
+ * the file could not be read.
+ */
+static int readGolden(char *filename, Golden *golden) {
+	FILE *f = fopen(filename, "r");
+	char line[300];
+	int count = 0;
+
+	if (f == NULL) {
+		return -1;
+	}
+	while (fgets(line, 300, f) != NULL && count < DT_MAXGOLDEN) {
+		if (line[0] == '#') {
+			continue;
+		}
+		if (sscanf(line, "%99s %lf %d %d %lu %lx %lx %lx",
+				golden[count].rule, &golden[count].angle,
+				&golden[count].factor, &golden[count].iteration,
+				&golden[count].symbols, &golden[count].string,
+				&golden[count].segments, &golden[count].framebuffer) == 8) {
+			count++;
+		}
+	}
+	fclose(f);
+	return count;
+}
+
+/**
+ * Looks up the golden reference of an iteration, NULL if there is none
+ */
+static Golden *findGolden(Golden *golden, int count, Golden *g) {
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (strcmp(golden[i].rule, g->rule) == 0 &&
+				golden[i].angle == g->angle &&
+				golden[i].factor == g->factor &&
+				golden[i].iteration == g->iteration) {
+			return &golden[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Checks one iteration with all engines against the reference. Returns
+ * the derived string of the next iteration.
+ */
+static char *testIteration(Golden *g, char *lsys, Pattern *p, int len,
+		Golden *golden, int count, FILE *update) {
+	Geometry *ref = geoNew();
+	Geometry *geo = geoNew();
+	Golden *expected;
+	char *next;
+	char *other;
+	Uint32 segments;
+	Uint32 framebuffer;
+	int i;
+
+	next = derivers[0].derive(lsys, p->rule);
+	g->symbols = strlen(next);
+	g->string = hash(HASH_START, next, g->symbols);
+	for (i = 1; i < COUNT(derivers); i++) {
+		other = derivers[i].derive(lsys, p->rule);
+		check(g, "string", derivers[i].name, g->string,
+			hash(HASH_START, other, strlen(other)));
+		if (other != lsys) {
+			memFree(other);
+		}
+	}
+
+	drawers[0].draw(next, len, p->angle, NULL, ref);
+	g->segments = hashGeometry(ref);
+	g->framebuffer = hashScreen();
+	for (i = 1; i < COUNT(drawers); i++) {
+		drawers[i].draw(next, len, p->angle, ref, geo);
+		segments = hashGeometry(geo);
+		framebuffer = hashScreen();
+		if (drawers[i].records) {
+			check(g, "segments", drawers[i].name, g->segments, segments);
+		}
+		check(g, "framebuffer", drawers[i].name, g->framebuffer,
+			framebuffer);
+	}
+
+	if (update != NULL) {
+		fprintf(update, "%s %g %d %d %lu %08lx %08lx %08lx\n", g->rule,
+			g->angle, g->factor, g->iteration, g->symbols, g->string,
+			g->segments, g->framebuffer);
+	} else {
+		expected = findGolden(golden, count, g);
+		if (expected == NULL) {
+			checks++;
+			failures++;
+			printf("FAIL %s -a %g -x %d, iteration %d: no golden "
+				"reference\n", g->rule, g->angle, g->factor, g->iteration);
+		} else {
+			check(g, "symbols", "reference", expected->symbols, g->symbols);
+			check(g, "string", "reference", expected->string, g->string);
+			check(g, "segments", "reference", expected->segments,
+				g->segments);
+			check(g, "framebuffer", "reference", expected->framebuffer,
+				g->framebuffer);
+		}
+	}
+
+	geoFree(geo);
+	geoFree(ref);
+	return next;
+}
+
+/**
+ * Counts a check of the history and reports a failure
+ */
+static void checkHistory(char *what, bool ok) {
+	checks++;
+	if (!ok) {
+		failures++;
+		printf("FAIL history: %s\n", what);
+	}
+}
+
+/**
+ * Fills the history past its memory budget, which has to evict the
+ * least recently used iterations but keep the first one
+ */
+static void testHistory() {
+	MemStats before;
+	MemStats after;
+	bool bounded = true;
+	char *lsys;
+	int i;
+
+	memGetStats(&before);
+	histSetBudget(DT_HISTBUDGET);
+	for (i = 1; i <= 10; i++) {
+		lsys = newn(char, DT_HISTSTRING);
+		memset(lsys, 'F', DT_HISTSTRING - 1);
+		lsys[DT_HISTSTRING - 1] = '\0';
+		histAdd(i, lsys);
+		bounded = bounded && histUsed() <= DT_HISTBUDGET;
+	}
+	checkHistory("cached strings exceed the budget", bounded);
+	checkHistory("oldest iteration was not evicted", histGet(2) == NULL);
+	checkHistory("first iteration was evicted", histGet(1) != NULL);
+	checkHistory("newest iteration was evicted", histGet(10) != NULL);
+	histClear();
+	histSetBudget(HIST_BUDGET);
+	memGetStats(&after);
+	checkHistory("evicted strings were not freed", after.live == before.live);
+}
+
+/**
+ * Checks the patterns of the README and the regressions against the
+ * golden references in the given file, or writes new references with
+ * -update
+ */
+int main(int argc, char *argv[]) {
+	Golden golden[DT_MAXGOLDEN];
+	Pattern corpus[DT_MAXPATTERNS + COUNT(regressions)];
+	Golden g;
+	MemStats before;
+	MemStats after;
+	FILE *update = NULL;
+	char axiom[] = "F";
+	char *filename;
+	char *lsys;
+	char *next;
+	double linelength;
+	int patterns;
+	int count = 0;
+	int i;
+
+	if (argc != 3 && (argc != 4 || strcmp(argv[1], "-update") != 0)) {
+		fprintf(stderr, "Usage: %s [-update] README golden.txt\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	patterns = readPatterns(argv[argc - 2], corpus, DT_MAXPATTERNS);
+	if (patterns <= 0) {
+		fprintf(stderr, "No patterns found in %s\n", argv[argc - 2]);
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < COUNT(regressions); i++) {
+		corpus[patterns++] = regressions[i];
+	}
+
+	filename = argv[argc - 1];
+	if (argc == 4) {
+		update = fopen(filename, "w");
+		if (update == NULL) {
+			fprintf(stderr, "Couldn't open %s\n", filename);
+			return EXIT_FAILURE;
+		}
+		fprintf(update, "# pattern angle factor iteration symbols string "
+			"segments framebuffer\n");
+	} else {
+		count = readGolden(filename, golden);
+		if (count < 0) {
+			fprintf(stderr, "Couldn't read %s\n", filename);
+			return EXIT_FAILURE;
+		}
+	}
+	if (sgInitHeadless("genplant test", DT_XRES, DT_YRES) != 0) {
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < patterns; i++) {
+		strcpy(g.rule, corpus[i].rule);
+		g.angle = corpus[i].angle;
+		g.factor = corpus[i].factor;
+		lsys = newn(char, 2);
+		strcpy(lsys, "F");
+		linelength = 40.;
+		/* the first iteration is the axiom */
+		for (g.iteration = 2;
+				lSysLength(lsys, corpus[i].rule) <= DT_MAXSYMBOLS;
+				g.iteration++) {
+			linelength *= ((double)corpus[i].factor/10.0);
+			next = testIteration(&g, lsys, &corpus[i], (int)linelength,
+				golden, count, update);
+			if (next != lsys) {
+				memFree(lsys);
+			}
+			lsys = next;
+		}
+
+		/* deriving all iterations at once ping-pongs between two
+		 * buffers */
+		g.iteration--;
+		memGetStats(&before);
+		next = lSysIterate(axiom, corpus[i].rule, g.iteration - 1);
+		memGetStats(&after);
+		check(&g, "string", "iterated", hash(HASH_START, lsys, strlen(lsys)),
+			hash(HASH_START, next, strlen(next)));
+		check(&g, "allocations", "iterated", g.iteration > 2 ? 2 : 1,
+			after.calls - before.calls);
+		if (next != axiom) {
+			memFree(next);
+		}
+		memFree(lsys);
+	}
+	specCancel();
+	SDL_Quit();
+	testHistory();
+
+	if (update != NULL) {
+		fclose(update);
+		printf("Golden references written to %s\n", filename);
+		return 0;
+	}
+	printf("%d checks, %d failed\n", checks, failures);
+	return failures == 0 ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,251 @@
+/* trace.c
+ * Spans of the drawing pipeline, written as Chrome trace
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include "SDL.h"
+#include "trace.h"
+#include "stats.h"
+#include "writer.h"
+#include "export.h"
+#include "tools.h"
+
+/**
+ * A span of time spent in a stage
+ */
+typedef struct {
+	const char *name;
+	double start;
+	double end;
+} TraceEvent;
+
+/**
+ * Events of one thread are kept in a list of blocks
+ */
+typedef struct TraceBlock {
+	TraceEvent events[TRACE_BLOCK];
+	int count;
+	struct TraceBlock *next;
+} TraceBlock;
+
+/**
+ * The events of a thread. Only the thread itself appends to them, so
+ * no locking is needed until they are written after all threads ended.
+ */
+typedef struct {
+	volatile int used;
+	Uint32 id;
+	const char *name;
+	TraceBlock *first;
+	TraceBlock *last;
+} TraceThread;
+
+/** Spans are only recorded after traceStart() */
+static bool enabled = false;
+/** Time of traceStart(), the origin of the trace */
+static double origin;
+/** Event buffers, claimed by the threads on their first event */
+static TraceThread threads[TRACE_MAXTHREADS];
+/** Events that did not fit because all buffers were claimed */
+static volatile int dropped = 0;
+/** The buffer of the calling thread */
+static __thread TraceThread *self = NULL;
+
+/**
+ * Returns true if both names are NULL or equal
+ */
+static bool sameName(const char *a, const char *b) {
+	return a == b || (a != NULL && b != NULL && strcmp(a, b) == 0);
+}
+
+/**
+ * Returns the buffer of the calling thread, which is claimed on the
+ * first call. A thread reuses the buffer of a finished thread with the
+ * same id and name, so threads that are started over and over again for
+ * the same job share one track of the trace.
+ */
+static TraceThread *findThread(const char *name) {
+	Uint32 id = SDL_ThreadID();
+	int i;
+
+	if (self != NULL) {
+		return self;
+	}
+	for (i = 0; i < TRACE_MAXTHREADS; i++) {
+		if (threads[i].used && threads[i].id == id &&
+				sameName(threads[i].name, name)) {
+			self = &threads[i];
+			return self;
+		}
+	}
+	for (i = 0; i < TRACE_MAXTHREADS; i++) {
+		if (__sync_bool_compare_and_swap(&threads[i].used, 0, 1)) {
+			threads[i].id = id;
+			threads[i].name = name;
+			self = &threads[i];
+			return self;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Starts recording spans. Must be called before any other threads are
+ * started.
+ */
+void traceStart() {
+	origin = statNow();
+	enabled = true;
+	traceThreadName("main");
+}
+
+/**
+ * Returns true if spans are recorded
+ */
+bool traceEnabled() {
+	return enabled;
+}
+
+/**
+ * Names the track of the calling thread in the trace. Must be called
+ * before the thread records any spans.
+ */
+void traceThreadName(const char *name) {
+	if (enabled) {
+		findThread(name);
+	}
+}
+
+/**
+ * Returns the start time of a span, to be passed to traceEnd()
+ */
+double traceBegin() {
+	return enabled ? statNow() : 0.;
+}
+
+/**
+ * Records a span from start until now. The name must be a string
+ * constant, as it is only written at the end.
+ */
+void traceEnd(const char *name, double start) {
+	TraceThread *t;
+	TraceBlock *b;
+	TraceEvent *e;
+
+	if (!enabled) {
+		return;
+	}
+	t = findThread(NULL);
+	if (t == NULL) {
+		__sync_fetch_and_add(&dropped, 1);
+		return;
+	}
+	b = t->last;
+	if (b == NULL || b->count == TRACE_BLOCK) {
+		b = new(TraceBlock);
+		b->count = 0;
+		b->next = NULL;
+		if (t->last == NULL) {
+			t->first = b;
+		} else {
+			t->last->next = b;
+		}
+		t->last = b;
+	}
+	e = &b->events[b->count++];
+	e->name = name;
+	e->start = start;
+	e->end = statNow();
+}
+
+/**
+ * Writes a time as microseconds since the start of the trace
+ */
+static void writeTime(Writer *w, double t) {
+	wrDouble(w, t * 1e6, 3);
+}
+
+/**
+ * Writes all recorded spans as Chrome trace event JSON, which can be
+ * viewed in Perfetto or chrome://tracing, and frees them. All other
+ * threads must have ended. Returns false if the file could not be
+ * written.
+ */
+bool traceWrite(char *filename) {
+	Writer *w = wrOpen(filename, exportCompressed(filename));
+	TraceBlock *b;
+	TraceBlock *next;
+	TraceEvent *e;
+	bool first = true;
+	long pid = (long)getpid();
+	int i;
+	int j;
+
+	enabled = false;
+	if (w == NULL) {
+		return false;
+	}
+	wrPuts(w, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+	for (i = 0; i < TRACE_MAXTHREADS; i++) {
+		if (!threads[i].used) {
+			continue;
+		}
+		if (threads[i].name != NULL) {
+			wrPuts(w, first ? "\n" : ",\n");
+			first = false;
+			wrPuts(w, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": ");
+			wrInt(w, pid);
+			wrPuts(w, ", \"tid\": ");
+			wrInt(w, i + 1);
+			wrPuts(w, ", \"args\": {\"name\": \"");
+			wrPuts(w, threads[i].name);
+			wrPuts(w, "\"}}");
+		}
+		for (b = threads[i].first; b != NULL; b = next) {
+			for (j = 0; j < b->count; j++) {
+				e = &b->events[j];
+				wrPuts(w, first ? "\n" : ",\n");
+				first = false;
+				wrPuts(w, "{\"name\": \"");
+				wrPuts(w, e->name);
+				wrPuts(w, "\", \"ph\": \"X\", \"pid\": ");
+				wrInt(w, pid);
+				wrPuts(w, ", \"tid\": ");
+				wrInt(w, i + 1);
+				wrPuts(w, ", \"ts\": ");
+				writeTime(w, e->start - origin);
+				wrPuts(w, ", \"dur\": ");
+				writeTime(w, e->end - e->start);
+				wrPuts(w, "}");
+			}
+			next = b->next;
+			memFree(b);
+		}
+		threads[i].first = NULL;
+		threads[i].last = NULL;
+	}
+	wrPuts(w, "\n]}\n");
+	if (dropped > 0) {
+		fprintf(stderr, "Trace: %d spans of too many threads dropped\n",
+			dropped);
+	}
+	return wrClose(w);
+}
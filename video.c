@@ -0,0 +1,295 @@
+/* video.c
+ * Raw video output as YUV4MPEG2 stream
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "video.h"
+#include "simplegfx.h"
+#include "trace.h"
+#include "tools.h"
+
+/* Header in front of every frame of the stream */
+#define VIDEO_FRAME "FRAME\n"
+#define VIDEO_FRAMELEN 6
+
+/**
+ * Writes all blocks to a file descriptor with as few system calls as
+ * possible, retrying on short writes. Returns false on errors.
+ */
+static bool writevAll(int fd, struct iovec *iov, int count) {
+	ssize_t r;
+
+	while (count > 0) {
+		r = writev(fd, iov, count);
+		if (r < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "Write error: %s\n", strerror(errno));
+			return false;
+		}
+		/* skip the blocks that were written completely */
+		while (count > 0 && (size_t)r >= iov->iov_len) {
+			r -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count > 0) {
+			iov->iov_base = (char*)iov->iov_base + r;
+			iov->iov_len -= r;
+		}
+	}
+	return true;
+}
+
+/**
+ * Thread function: writes all queued frames at once until the stream
+ * is closed
+ */
+static int videoThread(void *data) {
+	Video *video = (Video*)data;
+	struct iovec iov[VIDEO_RING];
+	bool ok = true;
+	double span;
+	int n;
+	int i;
+
+	traceThreadName("video");
+	for (;;) {
+		SDL_mutexP(video->lock);
+		while (video->count == 0 && !video->done) {
+			SDL_CondWait(video->cond, video->lock);
+		}
+		n = video->count;
+		for (i = 0; i < n; i++) {
+			iov[i].iov_base = video->bufs[(video->head + i) % VIDEO_RING];
+			iov[i].iov_len = video->frameSize;
+		}
+		SDL_mutexV(video->lock);
+		if (n == 0) {
+			break;
+		}
+
+		if (ok) {
+			span = traceBegin();
+			ok = writevAll(video->fd, iov, n);
+			traceEnd("video write", span);
+		}
+
+		SDL_mutexP(video->lock);
+		video->head = (video->head + n) % VIDEO_RING;
+		video->count -= n;
+		SDL_CondBroadcast(video->cond);
+		SDL_mutexV(video->lock);
+	}
+	video->failed = !ok;
+	return 0;
+}
+
+/**
+ * Reads the color of a pixel as 8 bit red, green and blue
+ */
+static void readPixel(SDL_Surface *surface, int x, int y, int *rgb) {
+	Uint8 r, g, b;
+
+	SDL_GetRGB(sgGetPixel(surface, x, y), surface->format, &r, &g, &b);
+	rgb[0] = r;
+	rgb[1] = g;
+	rgb[2] = b;
+}
+
+/**
+ * Turns a color difference scaled by 256 into a chroma sample. Saturated
+ * blue and red reach 256, which is clamped to the largest sample.
+ */
+static Uint8 chroma(int difference) {
+	int value = 128 + ((difference + 128) >> 8);
+
+	return (Uint8)(value > 255 ? 255 : value < 0 ? 0 : value);
+}
+
+/**
+ * Converts a surface to YUV 4:2:0 with full range BT.601 coefficients,
+ * as expected by the C420jpeg color space. The chroma is the average of
+ * each block of 2x2 pixels.
+ */
+static void convertFrame(Video *video, SDL_Surface *surface, Uint8 *out) {
+	SDL_PixelFormat *fmt = surface->format;
+	int w = video->width;
+	int h = video->height;
+	int cw = (w + 1) / 2;
+	Uint8 *ys = out;
+	Uint8 *us = out + w * h;
+	Uint8 *vs = us + cw * ((h + 1) / 2);
+	Uint32 *row;
+	Uint32 p;
+	int rgb[3];
+	int sum[3];
+	int x, y, dx, dy, i, n;
+
+	SDL_LockSurface(surface);
+	for (y = 0; y < h; y += 2) {
+		for (x = 0; x < w; x += 2) {
+			sum[0] = sum[1] = sum[2] = 0;
+			n = 0;
+			for (dy = 0; dy < 2 && y + dy < h; dy++) {
+				for (dx = 0; dx < 2 && x + dx < w; dx++) {
+					if (fmt->BytesPerPixel == 4) {
+						/* fast path for the usual 32 bit surfaces */
+						row = (Uint32*)((Uint8*)surface->pixels +
+							(y + dy) * surface->pitch);
+						p = row[x + dx];
+						rgb[0] = ((p & fmt->Rmask) >> fmt->Rshift) <<
+							fmt->Rloss;
+						rgb[1] = ((p & fmt->Gmask) >> fmt->Gshift) <<
+							fmt->Gloss;
+						rgb[2] = ((p & fmt->Bmask) >> fmt->Bshift) <<
+							fmt->Bloss;
+					} else {
+						readPixel(surface, x + dx, y + dy, rgb);
+					}
+					ys[(y + dy) * w + x + dx] = (Uint8)((77 * rgb[0] +
+						150 * rgb[1] + 29 * rgb[2] + 128) >> 8);
+					for (i = 0; i < 3; i++) {
+						sum[i] += rgb[i];
+					}
+					n++;
+				}
+			}
+			for (i = 0; i < 3; i++) {
+				sum[i] /= n;
+			}
+			us[(y / 2) * cw + x / 2] = chroma(-43 * sum[0] -
+				85 * sum[1] + 128 * sum[2]);
+			vs[(y / 2) * cw + x / 2] = chroma(128 * sum[0] -
+				107 * sum[1] - 21 * sum[2]);
+		}
+	}
+	SDL_UnlockSurface(surface);
+}
+
+/**
+ * Opens a video stream with the given frame size and rate and writes
+ * its header. A filename of "-" writes to stdout, e.g. to pipe the
+ * stream into an encoder. Returns NULL if the file could not be created.
+ */
+Video *videoOpen(char *filename, int width, int height, int fps) {
+	Video *video;
+	char header[100];
+	struct iovec iov;
+	int fd;
+	int i;
+
+	if (strcmp(filename, "-") == 0) {
+		fd = STDOUT_FILENO;
+	} else {
+		fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	}
+	if (fd < 0) {
+		fprintf(stderr, "Couldn't open %s: %s\n", filename, strerror(errno));
+		return NULL;
+	}
+	snprintf(header, 100, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+		width, height, fps);
+	iov.iov_base = header;
+	iov.iov_len = strlen(header);
+	if (!writevAll(fd, &iov, 1)) {
+		if (fd != STDOUT_FILENO) {
+			close(fd);
+		}
+		return NULL;
+	}
+
+	video = new(Video);
+	video->fd = fd;
+	video->width = width;
+	video->height = height;
+	video->frameSize = VIDEO_FRAMELEN + width * height +
+		2 * ((width + 1) / 2) * ((height + 1) / 2);
+	for (i = 0; i < VIDEO_RING; i++) {
+		video->bufs[i] = newn(char, video->frameSize);
+		memcpy(video->bufs[i], VIDEO_FRAME, VIDEO_FRAMELEN);
+	}
+	video->head = 0;
+	video->count = 0;
+	video->done = false;
+	video->failed = false;
+	video->frames = 0;
+	video->lock = SDL_CreateMutex();
+	video->cond = SDL_CreateCond();
+	video->thread = SDL_CreateThread(videoThread, video);
+	return video;
+}
+
+/**
+ * Appends the surface as the next frame. Waits if the writer thread is
+ * still busy with all buffers, so at most VIDEO_RING frames are queued.
+ */
+void videoFrame(Video *video, SDL_Surface *surface) {
+	char *buf;
+
+	SDL_mutexP(video->lock);
+	while (video->count == VIDEO_RING) {
+		SDL_CondWait(video->cond, video->lock);
+	}
+	buf = video->bufs[(video->head + video->count) % VIDEO_RING];
+	SDL_mutexV(video->lock);
+
+	/* the writer thread does not touch buffers that are not queued */
+	convertFrame(video, surface, (Uint8*)buf + VIDEO_FRAMELEN);
+
+	SDL_mutexP(video->lock);
+	video->count++;
+	SDL_CondBroadcast(video->cond);
+	SDL_mutexV(video->lock);
+	video->frames++;
+}
+
+/**
+ * Writes the remaining frames and closes the stream. Returns false if
+ * any frame could not be written.
+ */
+bool videoClose(Video *video) {
+	bool ok;
+	int i;
+
+	SDL_mutexP(video->lock);
+	video->done = true;
+	SDL_CondBroadcast(video->cond);
+	SDL_mutexV(video->lock);
+	SDL_WaitThread(video->thread, NULL);
+
+	ok = !video->failed;
+	if (video->fd != STDOUT_FILENO && close(video->fd) != 0) {
+		fprintf(stderr, "Couldn't close file: %s\n", strerror(errno));
+		ok = false;
+	}
+	SDL_DestroyCond(video->cond);
+	SDL_DestroyMutex(video->lock);
+	for (i = 0; i < VIDEO_RING; i++) {
+		memFree(video->bufs[i]);
+	}
+	memFree(video);
+	return ok;
+}
@@ -0,0 +1,483 @@
+/* writer.c
+ * Buffered file writer used by the exporters
+ *
+ * genplant - L-System plant renderer
+ * by Andreas Textor <textor.andreas@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef ZLIB
+#include <zlib.h>
+#include "SDL.h"
+#endif
+#include "writer.h"
+#include "trace.h"
+#include "tools.h"
+
+#ifdef ZLIB
+/* Number of buffers between the writer and the compression thread */
+#define WR_RING 4
+/* zlib compression level, exported text compresses well even at the
+ * fastest level */
+#define WR_ZLEVEL 1
+
+/**
+ * Ring of full buffers handed from the writer to the compression thread.
+ * The writer fills the buffer after the last queued one.
+ */
+struct Ring {
+	char *bufs[WR_RING];
+	size_t lens[WR_RING];
+	int head;		/* oldest queued buffer */
+	int count;		/* buffers queued or being compressed */
+	bool done;		/* no more buffers will be queued */
+	bool failed;
+	int fd;
+	SDL_mutex *lock;
+	SDL_cond *cond;
+	SDL_Thread *thread;
+};
+#endif
+
+/**
+ * Writes n bytes to a file descriptor, retrying on short writes.
+ * Returns false on errors.
+ */
+static bool writeAll(int fd, const char *data, size_t n) {
+	double span = traceBegin();
+	ssize_t r;
+
+	while (n > 0) {
+		r = write(fd, data, n);
+		if (r < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "Write error: %s\n", strerror(errno));
+			traceEnd("write", span);
+			return false;
+		}
+		data += r;
+		n -= r;
+	}
+	traceEnd("write", span);
+	return true;
+}
+
+#ifdef ZLIB
+/**
+ * Runs deflate on the pending input and writes all produced output
+ */
+static bool deflateAndWrite(z_stream *zs, int flush, char *out, int fd) {
+	int ret;
+
+	do {
+		zs->next_out = (Bytef*)out;
+		zs->avail_out = WR_BUFSIZE;
+		ret = deflate(zs, flush);
+		if (ret == Z_STREAM_ERROR) {
+			fprintf(stderr, "deflate() failed\n");
+			return false;
+		}
+		if (!writeAll(fd, out, WR_BUFSIZE - zs->avail_out)) {
+			return false;
+		}
+	} while (zs->avail_out == 0);
+	return true;
+}
+
+/**
+ * Thread function: compresses the queued buffers into a gzip stream
+ * until the writer is closed
+ */
+static int compressThread(void *data) {
+	struct Ring *ring = (struct Ring*)data;
+	z_stream zs;
+	char *out;
+	bool ok = true;
+	int slot;
+	double span;
+
+	traceThreadName("compress");
+	out = newn(char, WR_BUFSIZE);
+	memset(&zs, 0, sizeof(zs));
+	/* window bits + 16 selects the gzip format */
+	if (deflateInit2(&zs, WR_ZLEVEL, Z_DEFLATED, 15 + 16, 8,
+			Z_DEFAULT_STRATEGY) != Z_OK) {
+		fprintf(stderr, "deflateInit2() failed\n");
+		ok = false;
+	}
+
+	for (;;) {
+		SDL_mutexP(ring->lock);
+		while (ring->count == 0 && !ring->done) {
+			SDL_CondWait(ring->cond, ring->lock);
+		}
+		if (ring->count == 0) {
+			SDL_mutexV(ring->lock);
+			break;
+		}
+		slot = ring->head;
+		SDL_mutexV(ring->lock);
+
+		if (ok) {
+			span = traceBegin();
+			zs.next_in = (Bytef*)ring->bufs[slot];
+			zs.avail_in = ring->lens[slot];
+			ok = deflateAndWrite(&zs, Z_NO_FLUSH, out, ring->fd);
+			traceEnd("compress", span);
+		}
+
+		SDL_mutexP(ring->lock);
+		ring->head = (ring->head + 1) % WR_RING;
+		ring->count--;
+		SDL_CondBroadcast(ring->cond);
+		SDL_mutexV(ring->lock);
+	}
+
+	if (ok) {
+		zs.avail_in = 0;
+		ok = deflateAndWrite(&zs, Z_FINISH, out, ring->fd);
+	}
+	deflateEnd(&zs);
+	memFree(out);
+	ring->failed = !ok;
+	return 0;
+}
+
+/**
+ * Queues the full buffer for compression and continues with the next
+ * free one, waiting if the compression thread falls behind
+ */
+static void submit(Writer *w) {
+	struct Ring *ring = w->ring;
+
+	SDL_mutexP(ring->lock);
+	ring->lens[(ring->head + ring->count) % WR_RING] = w->len;
+	ring->count++;
+	SDL_CondBroadcast(ring->cond);
+	while (ring->count == WR_RING) {
+		SDL_CondWait(ring->cond, ring->lock);
+	}
+	w->buf = ring->bufs[(ring->head + ring->count) % WR_RING];
+	SDL_mutexV(ring->lock);
+	w->len = 0;
+}
+#endif
+
+/**
+ * Opens a file for writing. If compress is set, the data is gzip
+ * compressed on a separate thread. Returns NULL if the file could not
+ * be created.
+ */
+Writer *wrOpen(char *filename, bool compress) {
+	Writer *w;
+	int fd;
+#ifdef ZLIB
+	int i;
+#endif
+
+#ifndef ZLIB
+	if (compress) {
+		fprintf(stderr, "Compressed export is not compiled in\n");
+		return NULL;
+	}
+#endif
+	fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Couldn't open %s: %s\n", filename, strerror(errno));
+		return NULL;
+	}
+	w = new(Writer);
+	w->fd = fd;
+	w->len = 0;
+	w->written = 0;
+	w->failed = false;
+	w->ring = NULL;
+#ifdef ZLIB
+	if (compress) {
+		w->ring = new(struct Ring);
+		memset(w->ring, 0, sizeof(struct Ring));
+		for (i = 0; i < WR_RING; i++) {
+			w->ring->bufs[i] = newn(char, WR_BUFSIZE);
+		}
+		w->ring->fd = fd;
+		w->ring->lock = SDL_CreateMutex();
+		w->ring->cond = SDL_CreateCond();
+		w->ring->thread = SDL_CreateThread(compressThread, w->ring);
+		w->buf = w->ring->bufs[0];
+		return w;
+	}
+#endif
+	w->buf = newn(char, WR_BUFSIZE);
+	return w;
+}
+
+/**
+ * Writes out the buffer
+ */
+void wrFlush(Writer *w) {
+	if (w->len == 0) {
+		return;
+	}
+#ifdef ZLIB
+	if (w->ring != NULL) {
+		submit(w);
+		return;
+	}
+#endif
+	if (!w->failed && !writeAll(w->fd, w->buf, w->len)) {
+		w->failed = true;
+	}
+	w->len = 0;
+}
+
+/**
+ * Appends n bytes to the buffer. Blocks larger than the buffer are
+ * passed through directly unless the output is compressed.
+ */
+void wrWrite(Writer *w, const char *data, size_t n) {
+	size_t chunk;
+
+	w->written += n;
+	if (w->len + n > WR_BUFSIZE) {
+		wrFlush(w);
+	}
+	if (n >= WR_BUFSIZE && w->ring == NULL) {
+		if (!w->failed && !writeAll(w->fd, data, n)) {
+			w->failed = true;
+		}
+		return;
+	}
+	while (n > 0) {
+		chunk = WR_BUFSIZE - w->len;
+		if (chunk > n) {
+			chunk = n;
+		}
+		memcpy(w->buf + w->len, data, chunk);
+		w->len += chunk;
+		data += chunk;
+		n -= chunk;
+		if (w->len == WR_BUFSIZE) {
+			wrFlush(w);
+		}
+	}
+}
+
+/**
+ * Writes the buffered data followed by count blocks with one writev()
+ * call per WR_MAXIOV blocks, without copying the blocks into the buffer.
+ * Compressed output has to go through the buffers instead.
+ */
+void wrWritev(Writer *w, struct iovec *iov, int count) {
+	struct iovec vec[WR_MAXIOV + 1];
+	int done = 0;
+	int n;
+	int i;
+	ssize_t r;
+
+	if (w->ring != NULL) {
+		for (i = 0; i < count; i++) {
+			wrWrite(w, (char*)iov[i].iov_base, iov[i].iov_len);
+		}
+		return;
+	}
+
+	do {
+		n = 0;
+		if (w->len > 0) {
+			vec[n].iov_base = w->buf;
+			vec[n].iov_len = w->len;
+			n++;
+		}
+		for (i = 0; done < count && i < WR_MAXIOV; i++, done++) {
+			vec[n++] = iov[done];
+			w->written += iov[done].iov_len;
+		}
+		w->len = 0;
+
+		i = 0;
+		while (i < n && !w->failed) {
+			r = writev(w->fd, vec + i, n - i);
+			if (r < 0) {
+				if (errno != EINTR) {
+					fprintf(stderr, "Write error: %s\n", strerror(errno));
+					w->failed = true;
+				}
+				continue;
+			}
+			/* skip the blocks that were written completely */
+			while (i < n && (size_t)r >= vec[i].iov_len) {
+				r -= vec[i].iov_len;
+				i++;
+			}
+			if (i < n) {
+				vec[i].iov_base = (char*)vec[i].iov_base + r;
+				vec[i].iov_len -= r;
+			}
+		}
+	} while (done < count);
+}
+
+/**
+ * Appends a zero-terminated string
+ */
+void wrPuts(Writer *w, const char *s) {
+	wrWrite(w, s, strlen(s));
+}
+
+/**
+ * Makes sure at least n bytes fit into the buffer
+ */
+static char *reserve(Writer *w, size_t n) {
+	if (w->len + n > WR_BUFSIZE) {
+		wrFlush(w);
+	}
+	return w->buf + w->len;
+}
+
+/**
+ * Writes the decimal digits of x to p and returns the number of digits.
+ * At least mindigits digits are written, padded with leading zeros.
+ */
+static int putDigits(char *p, unsigned long x, int mindigits) {
+	char tmp[24];
+	int n = 0;
+	int i;
+
+	do {
+		tmp[n++] = '0' + (char)(x % 10);
+		x /= 10;
+	} while (x > 0 || n < mindigits);
+	for (i = 0; i < n; i++) {
+		p[i] = tmp[n - 1 - i];
+	}
+	return n;
+}
+
+/**
+ * Appends an integer in decimal notation
+ */
+void wrInt(Writer *w, long x) {
+	char *p = reserve(w, 24);
+	int n = 0;
+
+	if (x < 0) {
+		p[n++] = '-';
+		n += putDigits(p + n, -(unsigned long)x, 1);
+	} else {
+		n += putDigits(p + n, (unsigned long)x, 1);
+	}
+	w->len += n;
+	w->written += n;
+}
+
+/**
+ * Appends a floating point number with prec digits after the decimal
+ * point, like printf("%.*f") but without going through the locale aware
+ * libc formatter. Unlike printf, halfway cases are rounded away from zero
+ * instead of to even, and the last digit is rounded from the scaled value,
+ * so it can be one off from printf for values close to a halfway point.
+ * Values that are too large or not finite, and precisions above
+ * WR_MAXPREC, fall back to snprintf.
+ */
+void wrDouble(Writer *w, double d, int prec) {
+	static const unsigned long scales[WR_MAXPREC + 1] = {1, 10, 100, 1000,
+		10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+	char *p;
+	char *text;
+	unsigned long ip;
+	unsigned long fp;
+	int n = 0;
+	size_t size;
+
+	if (prec < 0 || prec > WR_MAXPREC || !(fabs(d) < 1e9)) {
+		/* the length is unbounded, so it is measured first */
+		n = snprintf(NULL, 0, "%.*f", prec, d);
+		if (n < 0) {
+			w->failed = true;
+			return;
+		}
+		size = (size_t)n + 1;
+		text = newn(char, size);
+		snprintf(text, size, "%.*f", prec, d);
+		wrWrite(w, text, (size_t)n);
+		memFree(text);
+		return;
+	}
+	p = reserve(w, 64);
+	if (d < 0 || (d == 0 && 1 / d < 0)) {
+		p[n++] = '-';
+		d = -d;
+	}
+	ip = (unsigned long)d;
+	fp = (unsigned long)((d - ip) * scales[prec] + 0.5);
+	if (fp >= scales[prec]) {
+		ip++;
+		fp -= scales[prec];
+	}
+	n += putDigits(p + n, ip, 1);
+	if (prec > 0) {
+		p[n++] = '.';
+		n += putDigits(p + n, fp, prec);
+	}
+	w->len += n;
+	w->written += n;
+}
+
+/**
+ * Flushes and closes the file. Returns false if any write failed.
+ */
+bool wrClose(Writer *w) {
+	bool ok;
+#ifdef ZLIB
+	int i;
+#endif
+
+	wrFlush(w);
+#ifdef ZLIB
+	if (w->ring != NULL) {
+		/* let the compression thread drain the ring and finish */
+		SDL_mutexP(w->ring->lock);
+		w->ring->done = true;
+		SDL_CondBroadcast(w->ring->cond);
+		SDL_mutexV(w->ring->lock);
+		SDL_WaitThread(w->ring->thread, NULL);
+		w->failed = w->failed || w->ring->failed;
+		for (i = 0; i < WR_RING; i++) {
+			memFree(w->ring->bufs[i]);
+		}
+		SDL_DestroyCond(w->ring->cond);
+		SDL_DestroyMutex(w->ring->lock);
+		memFree(w->ring);
+	} else {
+		memFree(w->buf);
+	}
+#else
+	memFree(w->buf);
+#endif
+	ok = !w->failed;
+	if (close(w->fd) != 0) {
+		ok = false;
+	}
+	memFree(w);
+	return ok;
+}